@@ -4,7 +4,8 @@
 
 
 // Reduction kernel to find the min value
-kernel void reduction_max(global const float* input, global float* output, local float* local_aux)
+// The records past the count are replaced with the neutral element of the reduction so the input is shared by the reductions unpadded
+kernel void reduction_max(global const float* input, global float* output, local float* local_aux, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -19,7 +20,7 @@ kernel void reduction_max(global const float* input, global float* output, local
 	int group_id = get_group_id(0);
 
 	// Cache all local values from global memory to local memory
-	local_aux[local_id] = input[global_id];
+	local_aux[local_id] = global_id < records_count ? input[global_id] : -FLT_MAX;
 
 	// Wait for all local threads to finish
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -52,7 +53,7 @@ kernel void reduction_max(global const float* input, global float* output, local
 }
 
 // Reduction kernel to find the max value 
-kernel void reduction_min(global const float* input, global float* output, local float* local_aux)
+kernel void reduction_min(global const float* input, global float* output, local float* local_aux, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -67,7 +68,7 @@ kernel void reduction_min(global const float* input, global float* output, local
 	int group_id = get_group_id(0);
 
 	// Cache all local values from global memory to local memory
-	local_aux[local_id] = input[global_id];
+	local_aux[local_id] = global_id < records_count ? input[global_id] : FLT_MAX;
 
 	// Wait for all local threads to finish copying from global to local memory
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -100,7 +101,7 @@ kernel void reduction_min(global const float* input, global float* output, local
 }
 
 // Reduction kernel to find the sum value
-kernel void reduction_sum(global const float* input, global float* output, local float* local_aux)
+kernel void reduction_sum(global const float* input, global float* output, local float* local_aux, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -115,7 +116,7 @@ kernel void reduction_sum(global const float* input, global float* output, local
 	int group_id = get_group_id(0);
 
 	// Cache all local values from global memory to local memory
-	local_aux[local_id] = input[global_id];
+	local_aux[local_id] = global_id < records_count ? input[global_id] : 0.0f;
 
 	// Wait for all local threads to finish
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -139,7 +140,8 @@ kernel void reduction_sum(global const float* input, global float* output, local
 }
 
 // Reduction kernel to find the standard deviation sum value
-kernel void reduction_standard_deviation(global const float* input, global float* output, local float* local_aux , float mean)
+// The mean is computed on device from the output of the sum reduction
+kernel void reduction_standard_deviation(global const float* input, global float* output, local float* local_aux, global const float* sum, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -153,8 +155,12 @@ kernel void reduction_standard_deviation(global const float* input, global float
 	// The group position relative to all other groups (globally)
 	int group_id = get_group_id(0);
 
+	// Mean of the temperatures
+	float mean = sum[0] / records_count;
+
 	// Calculate the sqaure of values minus the mean - Cache all local values from global memory to local memory
-	local_aux[local_id] = (input[global_id] - mean) * (input[global_id] - mean);
+	float difference = global_id < records_count ? input[global_id] - mean : 0.0f;
+	local_aux[local_id] = difference * difference;
 
 	// Wait for all local threads to finish
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -178,13 +184,168 @@ kernel void reduction_standard_deviation(global const float* input, global float
 }
 
 
+// Reduction kernel to find the max value - half storage
+// The temperatures are stored as halfs and widened to floats on load so no half arithmetic is needed
+// The records past the count are replaced with the neutral element of the reduction so the column needs no padding
+kernel void reduction_max_half(global const half* input, global float* output, local float* local_aux, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Widen the value and cache it in local memory
+	local_aux[local_id] = global_id < records_count ? vload_half(global_id, input) : -FLT_MAX;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - keep the larger value
+		if (local_id < stride)
+			local_aux[local_id] = max(local_aux[local_id], local_aux[local_id + stride]);
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Assign local max to output at group index
+	if (!local_id)
+		output[group_id] = local_aux[local_id];
+}
+
+// Reduction kernel to find the min value - half storage
+kernel void reduction_min_half(global const half* input, global float* output, local float* local_aux, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Widen the value and cache it in local memory
+	local_aux[local_id] = global_id < records_count ? vload_half(global_id, input) : FLT_MAX;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - keep the smaller value
+		if (local_id < stride)
+			local_aux[local_id] = min(local_aux[local_id], local_aux[local_id + stride]);
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Assign local min to output at group index
+	if (!local_id)
+		output[group_id] = local_aux[local_id];
+}
+
+// Reduction kernel to find the sum value - half storage
+kernel void reduction_sum_half(global const half* input, global float* output, local float* local_aux, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Widen the value and cache it in local memory
+	local_aux[local_id] = global_id < records_count ? vload_half(global_id, input) : 0.0f;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - sum the values at local id and local id + the stride
+		if (local_id < stride)
+			local_aux[local_id] += local_aux[local_id + stride];
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Assign local sum to output at group index
+	if (!local_id)
+		output[group_id] = local_aux[local_id];
+}
+
+// Reduction kernel to find the standard deviation sum value - half storage
+kernel void reduction_standard_deviation_half(global const half* input, global float* output, local float* local_aux, global const float* sum, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Mean of the temperatures
+	float mean = sum[0] / records_count;
+
+	// Widen the value and cache the square of the value minus the mean in local memory
+	float difference = global_id < records_count ? vload_half(global_id, input) - mean : 0.0f;
+	local_aux[local_id] = difference * difference;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - sum the values at local id and local id + the stride
+		if (local_id < stride)
+			local_aux[local_id] += local_aux[local_id + stride];
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Assign local sum to output at group index
+	if (!local_id)
+		output[group_id] = local_aux[local_id];
+}
+
+
 // *************************************************************************************************************************************
 // ************************************************************INTEGERS*****************************************************************
 // *************************************************************************************************************************************
 
 
 // Reduction kernel to find the min value
-kernel void reduction_max_int(global const int* input, global int* output, local int* local_aux)
+kernel void reduction_max_int(global const short* input, global int* output, local int* local_aux, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -195,8 +356,9 @@ kernel void reduction_max_int(global const int* input, global int* output, local
 	// Local work-items count
 	int local_size = get_local_size(0);
 
-	// Cache all local values from global memory to local memory
-	local_aux[local_id] = input[global_id];
+	// Cache all local values from global memory to local memory - fixed point tenths widened to int
+	// Work items past the end of the records hold the neutral element - the reductions share the input so it is not padded
+	local_aux[local_id] = global_id < records_count ? input[global_id] : INT_MIN;
 
 	// Wait for all local threads to finish
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -224,7 +386,7 @@ kernel void reduction_max_int(global const int* input, global int* output, local
 }
 
 // Reduction kernel to find the max value 
-kernel void reduction_min_int(global const int* input, global int* output, local int* local_aux)
+kernel void reduction_min_int(global const short* input, global int* output, local int* local_aux, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -235,8 +397,8 @@ kernel void reduction_min_int(global const int* input, global int* output, local
 	// Local work-items count
 	int local_size = get_local_size(0);
 
-	// Cache all local values from global memory to local memory
-	local_aux[local_id] = input[global_id];
+	// Cache all local values from global memory to local memory - work items past the end of the records hold the neutral element
+	local_aux[local_id] = global_id < records_count ? input[global_id] : INT_MAX;
 
 	// Wait for all local threads to finish
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -264,7 +426,7 @@ kernel void reduction_min_int(global const int* input, global int* output, local
 }
 
 // Reduction kernel to find the sum value
-kernel void reduction_sum_int(global const int* input, global int* output, local int* local_aux)
+kernel void reduction_sum_int(global const short* input, global int* output, local int* local_aux, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -275,8 +437,8 @@ kernel void reduction_sum_int(global const int* input, global int* output, local
 	// Local work-items count
 	int local_size = get_local_size(0);
 
-	// Cache all local values from global memory to local memory
-	local_aux[local_id] = input[global_id];
+	// Cache all local values from global memory to local memory - work items past the end of the records hold the neutral element
+	local_aux[local_id] = global_id < records_count ? input[global_id] : 0;
 
 	// Wait for all local threads to finish
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -300,7 +462,7 @@ kernel void reduction_sum_int(global const int* input, global int* output, local
 }
 
 // Reduction kernel to find the standard deviation sum value
-kernel void reduction_standard_deviation_int(global const int* input, global int* output, local int* local_aux, int mean)
+kernel void reduction_standard_deviation_int(global const short* input, global int* output, local int* local_aux, global const int* sum, int records_count)
 {
 	// Current thread
 	int global_id = get_global_id(0);
@@ -311,9 +473,15 @@ kernel void reduction_standard_deviation_int(global const int* input, global int
 	// Local work-items count
 	int local_size = get_local_size(0);
 
+	// Mean from the output of the sum reduction - stays on device so the kernel can be queued behind the sum
+	int mean = (int)((sum[0] / 10.0f) / records_count * 10.0f);
+
 	// Calculate the sqaure of values minus the mean - Cache all local values from global memory to local memory
 	// Divide by 10 due to multiplication of ints (multiplication to avoid loss of precision)
-	local_aux[local_id] = (input[global_id] - mean) * (input[global_id] - mean) / 10;
+	// Work items past the end of the records add nothing
+	local_aux[local_id] = 0;
+	if (global_id < records_count)
+		local_aux[local_id] = (input[global_id] - mean) * (input[global_id] - mean) / 10;
 
 	// Wait for all local threads to finish
 	barrier(CLK_LOCAL_MEM_FENCE);
@@ -338,10 +506,1709 @@ kernel void reduction_standard_deviation_int(global const int* input, global int
 
 
 // *************************************************************************************************************************************
-// ************************************************************SORTING******************************************************************
+// **********************************************************COMPRESSION****************************************************************
+// *************************************************************************************************************************************
+
+
+// The temperatures are compressed in blocks of one work group - the minimum of the block as the frame of reference
+// and the offsets of the temperatures from it bit packed into 32 bit words, each block starting on a new word
+
+// Decompress a temperature of a block - the offset may straddle two words
+int decompress_temperature(global const short* reference, global const uchar* bit_width, global const uint* block_offset, global const uint* words, int block, int index)
+{
+	// Every temperature of the block is the reference
+	int width = bit_width[block];
+	if (!width)
+		return reference[block];
+
+	// Position of the offset in the words of the block
+	int bit = index * width;
+	int word = block_offset[block] + bit / 32;
+	int shift = bit % 32;
+
+	// Unpack the offset and add it to the reference
+	uint delta = words[word] >> shift;
+	if (shift + width > 32)
+		delta |= words[word + 1] << (32 - shift);
+
+	return reference[block] + (int)(delta & ((1u << width) - 1));
+}
+
+// Reduction kernel to find the max, min and sum values of the compressed temperatures in a single pass
+// Each work group decompresses its block into local memory - the compressed column is the only global memory read
+kernel void reduction_compressed_int(global const short* reference, global const uchar* bit_width, global const uint* block_offset, global const uint* words,
+	global int* output, local int* local_max, local int* local_min, local int* local_sum, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// Block of the work group
+	int block = get_group_id(0);
+
+	// Decompress the temperature to local memory - work items past the end of the records hold the neutral elements
+	if (global_id < records_count)
+	{
+		int value = decompress_temperature(reference, bit_width, block_offset, words, block, local_id);
+		local_max[local_id] = value;
+		local_min[local_id] = value;
+		local_sum[local_id] = value;
+	}
+	else
+	{
+		local_max[local_id] = INT_MIN;
+		local_min[local_id] = INT_MAX;
+		local_sum[local_id] = 0;
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - combine the values at local id and local id + the stride
+		if (local_id < stride)
+		{
+			local_max[local_id] = max(local_max[local_id], local_max[local_id + stride]);
+			local_min[local_id] = min(local_min[local_id], local_min[local_id + stride]);
+			local_sum[local_id] += local_sum[local_id + stride];
+		}
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Combine the values of the work groups - atomic method
+	if (!local_id)
+	{
+		atomic_max(&output[0], local_max[0]);
+		atomic_min(&output[1], local_min[0]);
+		atomic_add(&output[2], local_sum[0]);
+	}
+}
+
+// Reduction kernel to find the standard deviation sum value of the compressed temperatures
+kernel void reduction_compressed_standard_deviation_int(global const short* reference, global const uchar* bit_width, global const uint* block_offset, global const uint* words,
+	global int* output, local int* local_aux, global const int* totals, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// Block of the work group
+	int block = get_group_id(0);
+
+	// Mean from the sum of the single pass reduction - stays on device
+	int mean = (int)((totals[2] / 10.0f) / records_count * 10.0f);
+
+	// Calculate the sqaure of the decompressed value minus the mean - divide by 10 due to multiplication of ints
+	// Work items past the end of the records add nothing
+	local_aux[local_id] = 0;
+	if (global_id < records_count)
+	{
+		int value = decompress_temperature(reference, bit_width, block_offset, words, block, local_id);
+		local_aux[local_id] = (value - mean) * (value - mean) / 10;
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - sum the values at local id and local id + the stride
+		if (local_id < stride)
+		{
+			local_aux[local_id] += local_aux[local_id + stride];
+		}
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Sum the values - atomic method
+	if (!local_id)
+		atomic_add(&output[0], local_aux[local_id]);
+}
+
+
+// *************************************************************************************************************************************
+// ************************************************************RECORDS******************************************************************
+// *************************************************************************************************************************************
+
+
+// Records are encoded as a station code (uchar), a packed timestamp (uint) and a temperature in fixed point tenths (short)
+// Timestamps pack the year in 12 bits, month in 4 bits, day in 5 bits, hour in 5 bits and minute in 6 bits
+
+// Unpack the year of a timestamp
+int timestamp_year(uint timestamp)
+{
+	return timestamp >> 20;
+}
+
+// Unpack the month of a timestamp
+int timestamp_month(uint timestamp)
+{
+	return (timestamp >> 16) & 0xF;
+}
+
+// Unpack the day of a timestamp
+int timestamp_day(uint timestamp)
+{
+	return (timestamp >> 11) & 0x1F;
+}
+
+// Unpack the time of day of a timestamp as hhmm
+int timestamp_time(uint timestamp)
+{
+	return ((timestamp >> 6) & 0x1F) * 100 + (timestamp & 0x3F);
+}
+
+
+// *************************************************************************************************************************************
+// ************************************************************FILTERS******************************************************************
 // *************************************************************************************************************************************
 
 
+// Filter kernel to select the records matching a query and compact their temperatures - all ranges are inclusive
+// The order of the selected records is kept within a work group but not between work groups
+kernel void filter_records(global const uchar* station, global const uint* timestamp, global const short* temperature,
+	global float* output, global short* output_int, global int* selected_count, local int* local_aux,
+	int station_filter, int2 year_range, int2 month_range, int2 day_range, int2 time_range, float2 temperature_range, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// Offset of this group in the compacted output
+	local int group_offset;
+
+	// Decode the record and evaluate the query on it - work items past the end of the records select nothing
+	int selected = 0;
+	if (global_id < records_count)
+	{
+		int year = timestamp_year(timestamp[global_id]);
+		int month = timestamp_month(timestamp[global_id]);
+		int day = timestamp_day(timestamp[global_id]);
+		int time = timestamp_time(timestamp[global_id]);
+		float value = temperature[global_id] / 10.0f;
+		selected = (station_filter < 0 || station[global_id] == station_filter) &&
+			(year >= year_range.x && year <= year_range.y) &&
+			(month >= month_range.x && month <= month_range.y) &&
+			(day >= day_range.x && day <= day_range.y) &&
+			(time >= time_range.x && time <= time_range.y) &&
+			(value >= temperature_range.x && value <= temperature_range.y);
+	}
+
+	// Cache the selection flags in local memory
+	local_aux[local_id] = selected;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Inclusive scan of the selection flags - the position of each selected record in the group
+	for (int stride = 1; stride < local_size; stride *= 2)
+	{
+		// Read the value a stride away before any thread overwrites it
+		int value = (local_id >= stride) ? local_aux[local_id - stride] : 0;
+
+		// Wait for all local threads to finish reading
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Add the value to the running total
+		local_aux[local_id] += value;
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Last thread holds the number of selected records in the group - reserve space in the output - atomic method
+	if (local_id == local_size - 1)
+		group_offset = atomic_add(&selected_count[0], local_aux[local_id]);
+
+	// Wait for the group offset
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Write the selected temperature to its compacted position - as a float and in fixed point
+	if (selected)
+	{
+		int position = group_offset + local_aux[local_id] - 1;
+		output[position] = temperature[global_id] / 10.0f;
+		output_int[position] = temperature[global_id];
+	}
+}
+
+
+// *************************************************************************************************************************************
+// ************************************************************SCANS********************************************************************
+// *************************************************************************************************************************************
+
+
+// Scan kernel - work-efficient Blelloch scan of a block of two elements per work item in local memory
+// Writes the total of each block to the block sums - the block sums are then scanned and added to every block
+kernel void scan_blelloch_int(global const int* input, global int* output, global int* block_sums, local int* local_aux, int elements, int inclusive)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item scans two elements of the block
+	int block_size = local_size * 2;
+	int first_index = group_id * block_size + local_id;
+	int second_index = first_index + local_size;
+
+	// Cache both values from global memory to local memory - 0 past the end of the input
+	local_aux[local_id] = (first_index < elements) ? input[first_index] : 0;
+	local_aux[local_id + local_size] = (second_index < elements) ? input[second_index] : 0;
+
+	// Up-sweep - build the sums of the tree in place
+	int offset = 1;
+	for (int stride = block_size / 2; stride > 0; stride /= 2)
+	{
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - add the left child to the right child
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			local_aux[right] += local_aux[left];
+		}
+
+		offset *= 2;
+	}
+
+	// The root holds the total of the block - store it and clear the root for the down-sweep
+	if (!local_id)
+	{
+		block_sums[group_id] = local_aux[block_size - 1];
+		local_aux[block_size - 1] = 0;
+	}
+
+	// Down-sweep - pass the sums of the left subtrees down the tree
+	for (int stride = 1; stride < block_size; stride *= 2)
+	{
+		offset /= 2;
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - swap the children and add the left to the right
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			int value = local_aux[left];
+			local_aux[left] = local_aux[right];
+			local_aux[right] += value;
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Local memory holds the exclusive scan - add the input for the inclusive scan
+	if (first_index < elements)
+		output[first_index] = local_aux[local_id] + (inclusive ? input[first_index] : 0);
+	if (second_index < elements)
+		output[second_index] = local_aux[local_id + local_size] + (inclusive ? input[second_index] : 0);
+}
+
+// Scan kernel - add the scanned block sums to every element of their block
+kernel void scan_add_block_sums_int(global int* output, global const int* block_offsets, int elements)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item updates two elements of the block
+	int first_index = group_id * local_size * 2 + local_id;
+	int second_index = first_index + local_size;
+
+	// Uniform add of the offset of the block
+	if (first_index < elements)
+		output[first_index] += block_offsets[group_id];
+	if (second_index < elements)
+		output[second_index] += block_offsets[group_id];
+}
+
+// Scan kernel - Blelloch max-scan of a block of two elements per work item in local memory
+// The same tree as the sum scan with max as the operator and INT_MIN as its identity - the running maximum of every element
+kernel void scan_blelloch_max_int(global const int* input, global int* output, global int* block_sums, local int* local_aux, int elements, int inclusive)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item scans two elements of the block
+	int block_size = local_size * 2;
+	int first_index = group_id * block_size + local_id;
+	int second_index = first_index + local_size;
+
+	// Cache both values from global memory to local memory - INT_MIN past the end of the input
+	local_aux[local_id] = (first_index < elements) ? input[first_index] : INT_MIN;
+	local_aux[local_id + local_size] = (second_index < elements) ? input[second_index] : INT_MIN;
+
+	// Up-sweep - build the maxima of the tree in place
+	int offset = 1;
+	for (int stride = block_size / 2; stride > 0; stride /= 2)
+	{
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - combine the left child into the right child
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			local_aux[right] = max(local_aux[right], local_aux[left]);
+		}
+
+		offset *= 2;
+	}
+
+	// The root holds the max of the block - store it and clear the root for the down-sweep
+	if (!local_id)
+	{
+		block_sums[group_id] = local_aux[block_size - 1];
+		local_aux[block_size - 1] = INT_MIN;
+	}
+
+	// Down-sweep - pass the maxima of the left subtrees down the tree
+	for (int stride = 1; stride < block_size; stride *= 2)
+	{
+		offset /= 2;
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - swap the children and combine the left into the right
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			int value = local_aux[left];
+			local_aux[left] = local_aux[right];
+			local_aux[right] = max(local_aux[right], value);
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Local memory holds the exclusive scan - combine the input for the inclusive scan
+	if (first_index < elements)
+		output[first_index] = inclusive ? max(local_aux[local_id], input[first_index]) : local_aux[local_id];
+	if (second_index < elements)
+		output[second_index] = inclusive ? max(local_aux[local_id + local_size], input[second_index]) : local_aux[local_id + local_size];
+}
+
+// Scan kernel - combine the scanned block maxima with every element of their block
+kernel void scan_add_block_sums_max_int(global int* output, global const int* block_offsets, int elements)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item updates two elements of the block
+	int first_index = group_id * local_size * 2 + local_id;
+	int second_index = first_index + local_size;
+
+	// Uniform max with the offset of the block
+	if (first_index < elements)
+		output[first_index] = max(output[first_index], block_offsets[group_id]);
+	if (second_index < elements)
+		output[second_index] = max(output[second_index], block_offsets[group_id]);
+}
+
+// Scan kernel - work-efficient Blelloch scan of a block of two elements per work item in local memory
+// Writes the total of each block to the block sums - the block sums are then scanned and added to every block
+kernel void scan_blelloch_float(global const float* input, global float* output, global float* block_sums, local float* local_aux, int elements, int inclusive)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item scans two elements of the block
+	int block_size = local_size * 2;
+	int first_index = group_id * block_size + local_id;
+	int second_index = first_index + local_size;
+
+	// Cache both values from global memory to local memory - 0 past the end of the input
+	local_aux[local_id] = (first_index < elements) ? input[first_index] : 0;
+	local_aux[local_id + local_size] = (second_index < elements) ? input[second_index] : 0;
+
+	// Up-sweep - build the sums of the tree in place
+	int offset = 1;
+	for (int stride = block_size / 2; stride > 0; stride /= 2)
+	{
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - add the left child to the right child
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			local_aux[right] += local_aux[left];
+		}
+
+		offset *= 2;
+	}
+
+	// The root holds the total of the block - store it and clear the root for the down-sweep
+	if (!local_id)
+	{
+		block_sums[group_id] = local_aux[block_size - 1];
+		local_aux[block_size - 1] = 0;
+	}
+
+	// Down-sweep - pass the sums of the left subtrees down the tree
+	for (int stride = 1; stride < block_size; stride *= 2)
+	{
+		offset /= 2;
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - swap the children and add the left to the right
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			float value = local_aux[left];
+			local_aux[left] = local_aux[right];
+			local_aux[right] += value;
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Local memory holds the exclusive scan - add the input for the inclusive scan
+	if (first_index < elements)
+		output[first_index] = local_aux[local_id] + (inclusive ? input[first_index] : 0);
+	if (second_index < elements)
+		output[second_index] = local_aux[local_id + local_size] + (inclusive ? input[second_index] : 0);
+}
+
+// Scan kernel - add the scanned block sums to every element of their block
+kernel void scan_add_block_sums_float(global float* output, global const float* block_offsets, int elements)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item updates two elements of the block
+	int first_index = group_id * local_size * 2 + local_id;
+	int second_index = first_index + local_size;
+
+	// Uniform add of the offset of the block
+	if (first_index < elements)
+		output[first_index] += block_offsets[group_id];
+	if (second_index < elements)
+		output[second_index] += block_offsets[group_id];
+}
+
+// Scan kernel - work-efficient Blelloch scan of a block of two elements per work item in local memory
+// Writes the total of each block to the block sums - the block sums are then scanned and added to every block
+kernel void scan_blelloch_long(global const long* input, global long* output, global long* block_sums, local long* local_aux, int elements, int inclusive)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item scans two elements of the block
+	int block_size = local_size * 2;
+	int first_index = group_id * block_size + local_id;
+	int second_index = first_index + local_size;
+
+	// Cache both values from global memory to local memory - 0 past the end of the input
+	local_aux[local_id] = (first_index < elements) ? input[first_index] : 0;
+	local_aux[local_id + local_size] = (second_index < elements) ? input[second_index] : 0;
+
+	// Up-sweep - build the sums of the tree in place
+	int offset = 1;
+	for (int stride = block_size / 2; stride > 0; stride /= 2)
+	{
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - add the left child to the right child
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			local_aux[right] += local_aux[left];
+		}
+
+		offset *= 2;
+	}
+
+	// The root holds the total of the block - store it and clear the root for the down-sweep
+	if (!local_id)
+	{
+		block_sums[group_id] = local_aux[block_size - 1];
+		local_aux[block_size - 1] = 0;
+	}
+
+	// Down-sweep - pass the sums of the left subtrees down the tree
+	for (int stride = 1; stride < block_size; stride *= 2)
+	{
+		offset /= 2;
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// If the local id is less than the stride - swap the children and add the left to the right
+		if (local_id < stride)
+		{
+			int left = offset * (2 * local_id + 1) - 1;
+			int right = offset * (2 * local_id + 2) - 1;
+			long value = local_aux[left];
+			local_aux[left] = local_aux[right];
+			local_aux[right] += value;
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Local memory holds the exclusive scan - add the input for the inclusive scan
+	if (first_index < elements)
+		output[first_index] = local_aux[local_id] + (inclusive ? input[first_index] : 0);
+	if (second_index < elements)
+		output[second_index] = local_aux[local_id + local_size] + (inclusive ? input[second_index] : 0);
+}
+
+// Scan kernel - add the scanned block sums to every element of their block
+kernel void scan_add_block_sums_long(global long* output, global const long* block_offsets, int elements)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Each work item updates two elements of the block
+	int first_index = group_id * local_size * 2 + local_id;
+	int second_index = first_index + local_size;
+
+	// Uniform add of the offset of the block
+	if (first_index < elements)
+		output[first_index] += block_offsets[group_id];
+	if (second_index < elements)
+		output[second_index] += block_offsets[group_id];
+}
+
+
+// *************************************************************************************************************************************
+// ************************************************************ROLLING WINDOWS**********************************************************
+// *************************************************************************************************************************************
+
+
+// Segmented inclusive max and min scan of a work group in local memory - Hillis-Steele in log2 of the work group size steps
+// A head starts a new segment, the heads are or-ed along so each item knows if a segment starts before it in the work group
+void local_segmented_max_min(local int* local_max, local int* local_min, local int* local_head, int local_id, int local_size)
+{
+	for (int stride = 1; stride < local_size; stride *= 2)
+	{
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// The item a stride to the left
+		int left_max = INT_MIN;
+		int left_min = INT_MAX;
+		int left_head = 0;
+		if (local_id >= stride)
+		{
+			left_max = local_max[local_id - stride];
+			left_min = local_min[local_id - stride];
+			left_head = local_head[local_id - stride];
+		}
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Combine it unless a segment starts at this item
+		if (!local_head[local_id])
+		{
+			local_max[local_id] = max(local_max[local_id], left_max);
+			local_min[local_id] = min(local_min[local_id], left_min);
+			local_head[local_id] = left_head;
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+// Rolling window kernel - prefix and suffix extremes of blocks of the window length (van Herk/Gil-Werman)
+// Records are ordered by station and time, blocks start at the first record of each station
+// Each work group scans whole blocks - as many as fit in the work group, or one longer block in chunks of the work group size
+// Both passes are segmented scans with the blocks as segments, the suffix pass runs from the end so the segments start at the block ends
+kernel void rolling_extremes_blocks(global const int* group_first, global const int* segment_start, global const short* input,
+	global int* prefix_max, global int* suffix_max, global int* prefix_min, global int* suffix_min,
+	local int* local_max, local int* local_min, local int* local_head, int window, int records_count)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Records of the blocks of the work group
+	int first = group_first[group_id];
+	int length = group_first[group_id + 1] - first;
+
+	// Prefix extremes - the last values of a chunk carry into the next chunk up to its first block start
+	int carry_max = INT_MIN;
+	int carry_min = INT_MAX;
+	for (int chunk = 0; chunk < length; chunk += local_size)
+	{
+		// Cache the chunk to local memory - the neutral elements past the end of the blocks
+		int i = first + chunk + local_id;
+		bool valid = chunk + local_id < length;
+		local_max[local_id] = valid ? input[i] : INT_MIN;
+		local_min[local_id] = valid ? input[i] : INT_MAX;
+		local_head[local_id] = valid && !((i - segment_start[i]) % window);
+		local_segmented_max_min(local_max, local_min, local_head, local_id, local_size);
+
+		// Items before the first block start of the chunk continue the block of the previous chunk
+		if (valid)
+		{
+			prefix_max[i] = local_head[local_id] ? local_max[local_id] : max(local_max[local_id], carry_max);
+			prefix_min[i] = local_head[local_id] ? local_min[local_id] : min(local_min[local_id], carry_min);
+		}
+		carry_max = local_head[local_size - 1] ? local_max[local_size - 1] : max(local_max[local_size - 1], carry_max);
+		carry_min = local_head[local_size - 1] ? local_min[local_size - 1] : min(local_min[local_size - 1], carry_min);
+
+		// Wait for all local threads to finish before the next chunk is cached
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Suffix extremes - the same scan from the last record back, a segment starts at the last record of each block
+	carry_max = INT_MIN;
+	carry_min = INT_MAX;
+	for (int chunk = 0; chunk < length; chunk += local_size)
+	{
+		// Cache the chunk to local memory in reverse order - the neutral elements past the start of the blocks
+		int i = first + length - 1 - chunk - local_id;
+		bool valid = chunk + local_id < length;
+		local_max[local_id] = valid ? input[i] : INT_MIN;
+		local_min[local_id] = valid ? input[i] : INT_MAX;
+		local_head[local_id] = valid && (i + 1 == records_count || !((i + 1 - segment_start[i + 1]) % window));
+		local_segmented_max_min(local_max, local_min, local_head, local_id, local_size);
+
+		// Items after the last block end of the chunk continue the block of the previous chunk
+		if (valid)
+		{
+			suffix_max[i] = local_head[local_id] ? local_max[local_id] : max(local_max[local_id], carry_max);
+			suffix_min[i] = local_head[local_id] ? local_min[local_id] : min(local_min[local_id], carry_min);
+		}
+		carry_max = local_head[local_size - 1] ? local_max[local_size - 1] : max(local_max[local_size - 1], carry_max);
+		carry_min = local_head[local_size - 1] ? local_min[local_size - 1] : min(local_min[local_size - 1], carry_min);
+
+		// Wait for all local threads to finish before the next chunk is cached
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+}
+
+// Rolling window kernel - mean, standard deviation, min and max of the window ending at each record
+// The window is cut at the first record of the station - ints are temperatures multiplied by 10
+kernel void rolling_statistics(global const int* segment_start, global const long* prefix_sum, global const long* prefix_sum_squares,
+	global const int* prefix_max, global const int* suffix_max, global const int* prefix_min, global const int* suffix_min,
+	global float* output, int window, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Work items past the end of the records
+	if (global_id >= records_count) return;
+
+	// First record of the window and the number of records in it
+	int first = max(global_id - window + 1, segment_start[global_id]);
+	long count = global_id - first + 1;
+
+	// Sums of the window from the inclusive prefix sums - one pass whatever the window length
+	long sum = prefix_sum[global_id] - (first ? prefix_sum[first - 1] : 0);
+	long sum_squares = prefix_sum_squares[global_id] - (first ? prefix_sum_squares[first - 1] : 0);
+
+	// Extremes of the window - a window starting a block lies in that block, any other spans the end of one block and the start of the next
+	int window_max = prefix_max[global_id];
+	int window_min = prefix_min[global_id];
+	if ((first - segment_start[global_id]) % window)
+	{
+		window_max = max(suffix_max[first], window_max);
+		window_min = min(suffix_min[first], window_min);
+	}
+
+	// Mean, standard deviation, min and max - the variance is exact in fixed point until the final division
+	output[global_id * 4] = (float)sum / count / 10.0f;
+	output[global_id * 4 + 1] = sqrt((float)(count * sum_squares - sum * sum) / (count * count)) / 10.0f;
+	output[global_id * 4 + 2] = window_min / 10.0f;
+	output[global_id * 4 + 3] = window_max / 10.0f;
+}
+
+
+// *************************************************************************************************************************************
+// ************************************************************AGGREGATES***************************************************************
+// *************************************************************************************************************************************
+
+
+// 64 bit atomics for the global sums - the kernels are left out of the program on a device without them
+#ifdef cl_khr_int64_base_atomics
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+
+// Aggregate kernel to find the count, sum, sum of squares, min and max of each station and month and the histogram of the temperatures
+// Sums are in fixed point tenths - each group reduces into local memory first, then merges into the global cells
+kernel void grouped_moments(global const uchar* station, global const uint* timestamp, global const short* input,
+	global long* cell_count, global long* cell_sum, global long* cell_sum_squares, global int* cell_min, global int* cell_max, global long* histogram,
+	local int* local_count, local int* local_sum, local int* local_sum_squares, local int* local_min, local int* local_max, local int* local_histogram,
+	int cells, int histogram_min, int histogram_bin_width, int histogram_bins, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// Clear the local cells and histogram
+	for (int i = local_id; i < cells; i += local_size)
+	{
+		local_count[i] = 0;
+		local_sum[i] = 0;
+		local_sum_squares[i] = 0;
+		local_min[i] = INT_MAX;
+		local_max[i] = INT_MIN;
+	}
+	for (int i = local_id; i < histogram_bins; i += local_size)
+		local_histogram[i] = 0;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Add the record to its cell and bin - atomic method
+	if (global_id < records_count)
+	{
+		int cell = station[global_id] * 12 + timestamp_month(timestamp[global_id]) - 1;
+		int value = input[global_id];
+		atomic_inc(&local_count[cell]);
+		atomic_add(&local_sum[cell], value);
+		atomic_add(&local_sum_squares[cell], value * value);
+		atomic_min(&local_min[cell], value);
+		atomic_max(&local_max[cell], value);
+		atomic_inc(&local_histogram[clamp((value - histogram_min) / histogram_bin_width, 0, histogram_bins - 1)]);
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Merge the cells of the group into the global cells - atomic method
+	for (int i = local_id; i < cells; i += local_size)
+	{
+		if (local_count[i])
+		{
+			atom_add(&cell_count[i], (long)local_count[i]);
+			atom_add(&cell_sum[i], (long)local_sum[i]);
+			atom_add(&cell_sum_squares[i], (long)local_sum_squares[i]);
+			atomic_min(&cell_min[i], local_min[i]);
+			atomic_max(&cell_max[i], local_max[i]);
+		}
+	}
+	for (int i = local_id; i < histogram_bins; i += local_size)
+		if (local_histogram[i])
+			atom_add(&histogram[i], (long)local_histogram[i]);
+}
+
+
+// Reduction kernel to find the moments of every station, year and month cell in a single pass
+// The records are ordered by station and time so a work group covers a short run of cells - a window of cells from the first cell of the group is
+// accumulated in local memory, the rare record outside the window goes straight to the global cell
+kernel void cube_moments(global const uchar* station, global const uint* timestamp, global const short* input,
+	global long* cell_count, global long* cell_sum, global long* cell_sum_squares, global int* cell_min, global int* cell_max,
+	local int* local_count, local int* local_sum, local int* local_sum_squares, local int* local_min, local int* local_max,
+	int first_year, int years, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// First record of the work group
+	int group_first = global_id - local_id;
+
+	// Clear the local window of cells
+	local_count[local_id] = 0;
+	local_sum[local_id] = 0;
+	local_sum_squares[local_id] = 0;
+	local_min[local_id] = INT_MAX;
+	local_max[local_id] = INT_MIN;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// First cell of the window
+	int window_first = 0;
+	if (group_first < records_count)
+		window_first = (station[group_first] * years + timestamp_year(timestamp[group_first]) - first_year) * 12 + timestamp_month(timestamp[group_first]) - 1;
+
+	// Add the record to its cell - atomic method
+	if (global_id < records_count)
+	{
+		int cell = (station[global_id] * years + timestamp_year(timestamp[global_id]) - first_year) * 12 + timestamp_month(timestamp[global_id]) - 1;
+		int value = input[global_id];
+		int slot = cell - window_first;
+		if (slot >= 0 && slot < local_size)
+		{
+			atomic_inc(&local_count[slot]);
+			atomic_add(&local_sum[slot], value);
+			atomic_add(&local_sum_squares[slot], value * value);
+			atomic_min(&local_min[slot], value);
+			atomic_max(&local_max[slot], value);
+		}
+		else
+		{
+			atom_add(&cell_count[cell], 1L);
+			atom_add(&cell_sum[cell], (long)value);
+			atom_add(&cell_sum_squares[cell], (long)(value * value));
+			atomic_min(&cell_min[cell], value);
+			atomic_max(&cell_max[cell], value);
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Merge the window into the global cells - atomic method
+	if (local_count[local_id])
+	{
+		int cell = window_first + local_id;
+		atom_add(&cell_count[cell], (long)local_count[local_id]);
+		atom_add(&cell_sum[cell], (long)local_sum[local_id]);
+		atom_add(&cell_sum_squares[cell], (long)local_sum_squares[local_id]);
+		atomic_min(&cell_min[cell], local_min[local_id]);
+		atomic_max(&cell_max[cell], local_max[local_id]);
+	}
+}
+#endif
+
+
+// *************************************************************************************************************************************
+// ************************************************************DATASETS*****************************************************************
+// *************************************************************************************************************************************
+
+
+// Segmented moments merge into the datasets with 64 bit atomics
+#ifdef cl_khr_int64_base_atomics
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+
+// Segmented reduction kernel to find the sum, sum of squares, min and max of every dataset in a single launch
+// The datasets are concatenated and each padded to whole work groups so every work group reduces a single dataset
+kernel void segmented_moments(global const short* input, global const int* group_dataset, global const int* dataset_offset, global const int* dataset_count,
+	global long* dataset_sum, global long* dataset_sum_squares, global int* dataset_min, global int* dataset_max,
+	local int* local_sum, local int* local_sum_squares, local int* local_min, local int* local_max)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Dataset of the work group
+	int dataset = group_dataset[group_id];
+
+	// Cache the value in local memory - the padding past the end of the dataset holds the neutral elements
+	if (global_id - dataset_offset[dataset] < dataset_count[dataset])
+	{
+		int value = input[global_id];
+		local_sum[local_id] = value;
+		local_sum_squares[local_id] = value * value;
+		local_min[local_id] = value;
+		local_max[local_id] = value;
+	}
+	else
+	{
+		local_sum[local_id] = 0;
+		local_sum_squares[local_id] = 0;
+		local_min[local_id] = INT_MAX;
+		local_max[local_id] = INT_MIN;
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - combine the values at local id and local id + the stride
+		if (local_id < stride)
+		{
+			local_sum[local_id] += local_sum[local_id + stride];
+			local_sum_squares[local_id] += local_sum_squares[local_id + stride];
+			local_min[local_id] = min(local_min[local_id], local_min[local_id + stride]);
+			local_max[local_id] = max(local_max[local_id], local_max[local_id + stride]);
+		}
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Merge the group into its dataset - atomic method
+	if (!local_id)
+	{
+		atom_add(&dataset_sum[dataset], (long)local_sum[0]);
+		atom_add(&dataset_sum_squares[dataset], (long)local_sum_squares[0]);
+		atomic_min(&dataset_min[dataset], local_min[0]);
+		atomic_max(&dataset_max[dataset], local_max[0]);
+	}
+}
+#endif
+
+
+// *************************************************************************************************************************************
+// ************************************************************EXTREMES*****************************************************************
+// *************************************************************************************************************************************
+
+
+// Temperature and record index packed into a 64 bit key - ordered by the temperature, then by the index
+long record_key(int value, int index)
+{
+	return upsample(value, (uint)index);
+}
+
+// 64 bit atomic min and max
+#ifdef cl_khr_int64_extended_atomics
+#pragma OPENCL EXTENSION cl_khr_int64_extended_atomics : enable
+
+// Reduction kernel to find the max and min keys - the records of the extremes come with the values
+kernel void reduction_arg_extremes(global const short* input, global long* output, local long* local_max, local long* local_min, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// Cache the key in local memory - work items past the end of the records hold the neutral elements
+	if (global_id < records_count)
+	{
+		local_max[local_id] = record_key(input[global_id], global_id);
+		local_min[local_id] = local_max[local_id];
+	}
+	else
+	{
+		local_max[local_id] = LONG_MIN;
+		local_min[local_id] = LONG_MAX;
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - keep the larger and smaller key
+		if (local_id < stride)
+		{
+			local_max[local_id] = max(local_max[local_id], local_max[local_id + stride]);
+			local_min[local_id] = min(local_min[local_id], local_min[local_id + stride]);
+		}
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Local key or global key - atomic method
+	if (!local_id)
+	{
+		atom_max(&output[0], local_max[0]);
+		atom_min(&output[1], local_min[0]);
+	}
+}
+#endif
+
+// Top K kernel - every group sorts its keys in local memory and writes its k coldest and k hottest
+// The host merges the candidates of the groups - unused candidates hold LONG_MAX and LONG_MIN
+kernel void top_k_records(global const short* input, global long* coldest, global long* hottest, local long* local_keys, int k, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Cache the key in local memory - work items past the end of the records sort first
+	local_keys[local_id] = global_id < records_count ? record_key(input[global_id], global_id) : LONG_MIN;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Bitonic sort of the keys - ascending
+	for (int size = 2; size <= local_size; size *= 2)
+	{
+		for (int stride = size / 2; stride > 0; stride /= 2)
+		{
+			// Compare and swap with the partner - the direction alternates between the sequences of the size
+			int partner = local_id ^ stride;
+			if (partner > local_id)
+			{
+				long a = local_keys[local_id];
+				long b = local_keys[partner];
+				if ((a > b) == ((local_id & size) == 0))
+				{
+					local_keys[local_id] = b;
+					local_keys[partner] = a;
+				}
+			}
+
+			// Wait for all local threads to finish
+			barrier(CLK_LOCAL_MEM_FENCE);
+		}
+	}
+
+	// Records of the group - the keys of the work items past the end of the records are at the start
+	int group_records = clamp(records_count - group_id * local_size, 0, local_size);
+	int first = local_size - group_records;
+
+	// Write the k coldest and the k hottest of the group
+	if (local_id < k)
+	{
+		coldest[group_id * k + local_id] = local_id < group_records ? local_keys[first + local_id] : LONG_MAX;
+		hottest[group_id * k + local_id] = local_id < group_records ? local_keys[local_size - 1 - local_id] : LONG_MIN;
+	}
+}
+
+
+// *************************************************************************************************************************************
+// ************************************************************ANOMALIES****************************************************************
+// *************************************************************************************************************************************
+
+
+// First day of each month in a leap year - the 29th of February keeps its own day of the year
+constant int month_first_day[12] = { 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335 };
+
+// Day of the year of a timestamp - 0 to 365
+int timestamp_day_of_year(uint timestamp)
+{
+	return month_first_day[timestamp_month(timestamp) - 1] + timestamp_day(timestamp) - 1;
+}
+
+// 64 bit atomics for the sums of the cells
+#ifdef cl_khr_int64_base_atomics
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+
+// Climatology kernel to find the count, sum and sum of squares of each station and day of the year
+// There are too many cells for local memory - the records are added to the global cells - atomic method
+kernel void day_of_year_moments(global const uchar* station, global const uint* timestamp, global const short* input,
+	global int* cell_count, global long* cell_sum, global long* cell_sum_squares, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Add the record to its cell
+	if (global_id < records_count)
+	{
+		int cell = station[global_id] * 366 + timestamp_day_of_year(timestamp[global_id]);
+		int value = input[global_id];
+		atomic_inc(&cell_count[cell]);
+		atom_add(&cell_sum[cell], (long)value);
+		atom_add(&cell_sum_squares[cell], (long)(value * value));
+	}
+}
+#endif
+
+// Climatology kernel to find the baseline mean and standard deviation of each station and day of the year
+// Each baseline pools the days within the half window either side - wrapping around the end of the year
+kernel void day_of_year_baseline(global const int* cell_count, global const long* cell_sum, global const long* cell_sum_squares,
+	global float* baseline_mean, global float* baseline_std_dev, int half_window, int cells)
+{
+	// Current thread - one cell each
+	int global_id = get_global_id(0);
+	if (global_id >= cells)
+		return;
+
+	// Station and day of the year of the cell
+	int station = global_id / 366;
+	int day = global_id % 366;
+
+	// Pool the cells of the window
+	long count = 0;
+	long sum = 0;
+	long sum_squares = 0;
+	for (int offset = -half_window; offset <= half_window; offset++)
+	{
+		int cell = station * 366 + (day + offset + 366) % 366;
+		count += cell_count[cell];
+		sum += cell_sum[cell];
+		sum_squares += cell_sum_squares[cell];
+	}
+
+	// Mean and standard deviation in fixed point tenths - a window without readings has no baseline
+	float mean = count ? (float)sum / count : 0.0f;
+	baseline_mean[global_id] = mean;
+	baseline_std_dev[global_id] = count ? sqrt(max((float)sum_squares / count - mean * mean, 0.0f)) : 0.0f;
+}
+
+// Anomaly kernel to score every record against the baseline of its station and day of the year
+// The records with a z-score over the threshold are compacted to the output as their index and z-score
+kernel void score_anomalies(global const uchar* station, global const uint* timestamp, global const short* input,
+	global const float* baseline_mean, global const float* baseline_std_dev, global int* anomaly_index, global float* anomaly_score, global int* anomaly_count,
+	local int* local_aux, float threshold, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// Offset of this group in the compacted output
+	local int group_offset;
+
+	// Score the record against its baseline - work items past the end of the records and records without a spread select nothing
+	int selected = 0;
+	float score = 0.0f;
+	if (global_id < records_count)
+	{
+		int cell = station[global_id] * 366 + timestamp_day_of_year(timestamp[global_id]);
+		if (baseline_std_dev[cell] > 0.0f)
+		{
+			score = (input[global_id] - baseline_mean[cell]) / baseline_std_dev[cell];
+			selected = fabs(score) > threshold;
+		}
+	}
+
+	// Cache the selection flags in local memory
+	local_aux[local_id] = selected;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Inclusive scan of the selection flags - the position of each selected record in the group
+	for (int stride = 1; stride < local_size; stride *= 2)
+	{
+		// Read the value a stride away before any thread overwrites it
+		int value = (local_id >= stride) ? local_aux[local_id - stride] : 0;
+
+		// Wait for all local threads to finish reading
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Add the value to the running total
+		local_aux[local_id] += value;
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Last thread holds the number of selected records in the group - reserve space in the output - atomic method
+	if (local_id == local_size - 1)
+		group_offset = atomic_add(&anomaly_count[0], local_aux[local_id]);
+
+	// Wait for the group offset
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Write the record index and z-score to its compacted position
+	if (selected)
+	{
+		int position = group_offset + local_aux[local_id] - 1;
+		anomaly_index[position] = global_id;
+		anomaly_score[position] = score;
+	}
+}
+
+
+// *************************************************************************************************************************************
+// **********************************************************CORRELATIONS***************************************************************
+// *************************************************************************************************************************************
+
+
+// 64 bit atomics for the co-moments of the pairs
+#ifdef cl_khr_int64_base_atomics
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+
+// Join kernel to find the co-moments of every pair of stations - the records are sorted by timestamp
+// Each record is joined to the records of other stations that follow it with the same timestamp
+// Values pack the station in the high half and the temperature in fixed point tenths in the low half
+kernel void join_co_moments(global const uint* keys, global const int* values,
+	global long* pair_count, global long* pair_sum_a, global long* pair_sum_b, global long* pair_sum_aa, global long* pair_sum_bb, global long* pair_sum_ab,
+	local int* local_count, local int* local_sum_a, local int* local_sum_b, local int* local_sum_aa, local int* local_sum_bb, local int* local_sum_ab,
+	int stations, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// Number of pairs - one cell per ordered pair of stations
+	int cells = stations * stations;
+
+	// Clear the local cells
+	for (int i = local_id; i < cells; i += local_size)
+	{
+		local_count[i] = 0;
+		local_sum_a[i] = 0;
+		local_sum_b[i] = 0;
+		local_sum_aa[i] = 0;
+		local_sum_bb[i] = 0;
+		local_sum_ab[i] = 0;
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Join the record to the following records of the same timestamp - atomic method
+	if (global_id < records_count)
+	{
+		int station = values[global_id] >> 16;
+		int value = (short)(values[global_id] & 0xFFFF);
+		for (int i = global_id + 1; i < records_count && keys[i] == keys[global_id]; i++)
+		{
+			// Same station twice at a timestamp - not a pair
+			int other_station = values[i] >> 16;
+			if (other_station == station)
+				continue;
+
+			// The pair is ordered by station - a is the lower station
+			int other_value = (short)(values[i] & 0xFFFF);
+			int a = station < other_station ? value : other_value;
+			int b = station < other_station ? other_value : value;
+			int cell = min(station, other_station) * stations + max(station, other_station);
+			atomic_inc(&local_count[cell]);
+			atomic_add(&local_sum_a[cell], a);
+			atomic_add(&local_sum_b[cell], b);
+			atomic_add(&local_sum_aa[cell], a * a);
+			atomic_add(&local_sum_bb[cell], b * b);
+			atomic_add(&local_sum_ab[cell], a * b);
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Merge the cells of the group into the global cells - atomic method
+	for (int i = local_id; i < cells; i += local_size)
+	{
+		if (local_count[i])
+		{
+			atom_add(&pair_count[i], (long)local_count[i]);
+			atom_add(&pair_sum_a[i], (long)local_sum_a[i]);
+			atom_add(&pair_sum_b[i], (long)local_sum_b[i]);
+			atom_add(&pair_sum_aa[i], (long)local_sum_aa[i]);
+			atom_add(&pair_sum_bb[i], (long)local_sum_bb[i]);
+			atom_add(&pair_sum_ab[i], (long)local_sum_ab[i]);
+		}
+	}
+}
+#endif
+
+
+// *************************************************************************************************************************************
+// *************************************************************SPELLS******************************************************************
+// *************************************************************************************************************************************
+
+
+// A reading is an event if it is above the threshold, or below it
+bool threshold_event(int value, int threshold, int above)
+{
+	return above ? value > threshold : value < threshold;
+}
+
+// Count-if kernel of the events of every station and year, and the run breaks of the records ordered by station and time
+// A break is a record that is not an event - the first event of a station and year breaks at the record before it so no run crosses a segment
+// The inclusive max-scan of the breaks is the last break at or before every record
+kernel void threshold_events(global const uchar* station, global const uint* timestamp, global const short* input, global int* breaks,
+	global int* cell_count, local int* local_count, int threshold, int above, int first_year, int years, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// First record of the work group
+	int group_first = global_id - local_id;
+
+	// Clear the local window of cells
+	local_count[local_id] = 0;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// First cell of the window - the records of a group fall in a short run of cells
+	int window_first = 0;
+	if (group_first < records_count)
+		window_first = station[group_first] * years + timestamp_year(timestamp[group_first]) - first_year;
+
+	if (global_id < records_count)
+	{
+		// Event and first record of a station and year
+		int year = timestamp_year(timestamp[global_id]);
+		bool event = threshold_event(input[global_id], threshold, above);
+		bool segment_start = !global_id || station[global_id] != station[global_id - 1] || year != timestamp_year(timestamp[global_id - 1]);
+		breaks[global_id] = !event ? global_id : (segment_start ? global_id - 1 : INT_MIN);
+
+		// Count the event - atomic method, in the window or straight to the global cell
+		if (event)
+		{
+			int cell = station[global_id] * years + year - first_year;
+			int slot = cell - window_first;
+			if (slot >= 0 && slot < local_size)
+				atomic_inc(&local_count[slot]);
+			else
+				atomic_inc(&cell_count[cell]);
+		}
+	}
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Merge the window into the global cells - atomic method
+	if (local_count[local_id])
+		atomic_add(&cell_count[window_first + local_id], local_count[local_id]);
+}
+
+// 64 bit atomic max for the longest spells
+#ifdef cl_khr_int64_extended_atomics
+#pragma OPENCL EXTENSION cl_khr_int64_extended_atomics : enable
+
+// Spell kernel - the length of every run of events at its last record, the longest run of every station and year kept with a 64 bit atomic max
+// The key packs the length in the high half and the complement of the last record in the low half so a tie keeps the earliest run
+kernel void spell_lengths(global const uchar* station, global const uint* timestamp, global const short* input, global const int* last_break,
+	global long* cell_spell, int threshold, int above, int first_year, int years, int records_count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Only the last record of a run of events
+	if (global_id >= records_count || !threshold_event(input[global_id], threshold, above))
+		return;
+	int year = timestamp_year(timestamp[global_id]);
+	int next = global_id + 1;
+	if (next < records_count && threshold_event(input[next], threshold, above) && station[next] == station[global_id] && timestamp_year(timestamp[next]) == year)
+		return;
+
+	// Length of the run back to its last break
+	int length = global_id - last_break[global_id];
+	int cell = station[global_id] * years + year - first_year;
+	atom_max(&cell_spell[cell], upsample(length, ~(uint)global_id));
+}
+#endif
+
+
+// *************************************************************************************************************************************
+// ***********************************************************BOOTSTRAP*****************************************************************
+// *************************************************************************************************************************************
+
+
+// Counter based random numbers - Philox4x32-10 (Salmon et al.), four 32 bit numbers from a 128 bit counter and a 64 bit key
+// The same counter and key always give the same numbers so a resample needs no stored indices and no state between work items
+void philox4x32(uint* counter, uint key_low, uint key_high)
+{
+	for (int round = 0; round < 10; round++)
+	{
+		uint high_0 = mul_hi(0xD2511F53u, counter[0]);
+		uint low_0 = 0xD2511F53u * counter[0];
+		uint high_1 = mul_hi(0xCD9E8D57u, counter[2]);
+		uint low_1 = 0xCD9E8D57u * counter[2];
+		counter[0] = high_1 ^ counter[1] ^ key_low;
+		counter[1] = low_1;
+		counter[2] = high_0 ^ counter[3] ^ key_high;
+		counter[3] = low_0;
+
+		// Bump the key - Weyl sequence of the golden ratio and the square root of 3
+		key_low += 0x9E3779B9u;
+		key_high += 0xBB67AE85u;
+	}
+}
+
+// Reduction kernel to find the sum and sum of squares of a bootstrap replicate - one work group per replicate
+// Each work item draws its share of the records with replacement, four indices per call of the generator, and sums them in private memory
+// The private sums are then reduced in local memory - fixed point so the sums are exact
+// The last work group sums the records themselves in place of a replicate - the exact moments of the point estimates
+kernel void bootstrap_moments(global const short* input, global long* replicate_sum, global long* replicate_sum_squares,
+	local long* local_sum, local long* local_sum_squares, uint seed_low, uint seed_high, int records_count)
+{
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally) - the replicate
+	int replicate = get_group_id(0);
+	bool sample = replicate == (int)get_num_groups(0) - 1;
+
+	// Draw the records of the replicate - the counter is the block of four draws and the replicate
+	long sum = 0;
+	long sum_squares = 0;
+	for (int block = local_id; block * 4 < records_count; block += local_size)
+	{
+		uint counter[4] = { (uint)block, (uint)replicate, 0, 0 };
+		if (!sample)
+			philox4x32(counter, seed_low, seed_high);
+		for (int i = 0; i < 4 && block * 4 + i < records_count; i++)
+		{
+			// Uniform index - the high half of the product of the random number and the count - or every record once for the sample
+			int value = input[sample ? block * 4 + i : mul_hi(counter[i], (uint)records_count)];
+			sum += value;
+			sum_squares += value * value;
+		}
+	}
+
+	// Cache the private sums in local memory
+	local_sum[local_id] = sum;
+	local_sum_squares[local_id] = sum_squares;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Loop through local memory - coalesced memory access
+	for (int stride = local_size / 2; stride > 0; stride /= 2)
+	{
+		// If the local id is less than the stride - sum the values at local id and local id + the stride
+		if (local_id < stride)
+		{
+			local_sum[local_id] += local_sum[local_id + stride];
+			local_sum_squares[local_id] += local_sum_squares[local_id + stride];
+		}
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// Assign the sums to the output at the replicate index
+	if (!local_id)
+	{
+		replicate_sum[replicate] = local_sum[0];
+		replicate_sum_squares[replicate] = local_sum_squares[0];
+	}
+}
+
+
+// *************************************************************************************************************************************
+// ***********************************************************BANDWIDTH*****************************************************************
+// *************************************************************************************************************************************
+
+
+// Copy kernel of the STREAM benchmark - one vector read and written per work item, no arithmetic
+// The time of the copy is the sustainable memory bandwidth of the device
+kernel void stream_copy(global const float4* input, global float4* output)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	output[global_id] = input[global_id];
+}
+
+
+// *************************************************************************************************************************************
+// ************************************************************SORTING******************************************************************
+// *************************************************************************************************************************************
+
+
+// Radix sort kernel - count the 4 bit digits of the keys of each work group
+// The counts are stored digit major so the exclusive scan of the histogram is the first position of every digit of every group
+kernel void radix_histogram(global const uint* keys, global int* histogram, local int* local_counts, int shift, int count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Number of groups
+	int groups = get_num_groups(0);
+
+	// Clear the local counts
+	if (local_id < 16)
+		local_counts[local_id] = 0;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Count the digit of the key - atomic method
+	if (global_id < count)
+		atomic_inc(&local_counts[(keys[global_id] >> shift) & 15]);
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Store the counts of the group
+	if (local_id < 16)
+		histogram[local_id * groups + group_id] = local_counts[local_id];
+}
+
+// Radix sort kernel - stable scatter of the keys and values of each work group on a 4 bit digit
+// The group first sorts its keys on the digit in local memory with a split per bit, the rank of a key among the keys of its digit
+// is then its local position past the first key of the digit, added to the position of the digit of the group from the scanned histogram
+kernel void radix_scatter(global const uint* keys, global const int* values, global const int* digit_offsets, global uint* sorted_keys, global int* sorted_values,
+	local uint* local_keys, local int* local_values, local int* local_scan, local int* local_digit_start, int shift, int count)
+{
+	// Current thread
+	int global_id = get_global_id(0);
+
+	// Local work item ID
+	int local_id = get_local_id(0);
+
+	// Local work-items count
+	int local_size = get_local_size(0);
+
+	// The group position relative to all other groups (globally)
+	int group_id = get_group_id(0);
+
+	// Number of groups
+	int groups = get_num_groups(0);
+
+	// Cache the keys and values to local memory - the largest key past the end so the padding stays after every key of the group
+	uint key = (global_id < count) ? keys[global_id] : UINT_MAX;
+	int value = (global_id < count) ? values[global_id] : 0;
+
+	// Split on each bit of the digit - the zeros first, in their order
+	for (int bit = 0; bit < 4; bit++)
+	{
+		// Inclusive scan of the zero flags - Hillis-Steele
+		int zero = !((key >> (shift + bit)) & 1);
+		local_scan[local_id] = zero;
+		for (int stride = 1; stride < local_size; stride *= 2)
+		{
+			// Wait for all local threads to finish
+			barrier(CLK_LOCAL_MEM_FENCE);
+			int left = (local_id >= stride) ? local_scan[local_id - stride] : 0;
+
+			// Wait for all local threads to finish
+			barrier(CLK_LOCAL_MEM_FENCE);
+			local_scan[local_id] += left;
+		}
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Position of the key - the ones follow all zeros
+		int zeros = local_scan[local_size - 1];
+		int position = zero ? local_scan[local_id] - 1 : zeros + local_id - local_scan[local_id];
+		local_keys[position] = key;
+		local_values[position] = value;
+
+		// Wait for all local threads to finish
+		barrier(CLK_LOCAL_MEM_FENCE);
+		key = local_keys[local_id];
+		value = local_values[local_id];
+
+		// Wait for all local threads to finish before the next split is written
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// First local position of every digit - where the digit differs from the key before
+	int digit = (key >> shift) & 15;
+	if (!local_id || digit != ((local_keys[local_id - 1] >> shift) & 15))
+		local_digit_start[digit] = local_id;
+
+	// Wait for all local threads to finish
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Scatter the keys of the group - the padding is sorted after all of them
+	if (group_id * local_size + local_id < count)
+	{
+		int position = digit_offsets[digit * groups + group_id] + local_id - local_digit_start[digit];
+		sorted_keys[position] = key;
+		sorted_values[position] = value;
+	}
+}
+
+
 //// Sorting kernel to sort the input data - integers - selection sort using global memory
 //// Reference - http://www.bealto.com/gpu-sorting_parallel-selection.html - Eric Bainville - June 2011
 //kernel void parallel_selection_sort(global const float* input, global float* output, local float* local_aux)
@@ -8,6 +8,23 @@
 #endif
 
 #include <chrono>
+#include <cfloat>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+// Compressed input - zlib and zstd come from the vcpkg manifest of the project, other builds define USE_ZLIB / USE_ZSTD when linking them
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+#include <sys/stat.h>
 #include "Utils.h"
 
 // ******************************************************************************************************************************************************************
@@ -18,6 +35,187 @@ typedef chrono::high_resolution_clock hi_res_clock;
 typedef chrono::high_resolution_clock::time_point hi_res_time_point;
 typedef int integer;
 typedef float floating_point;
+typedef cl_short fixed_point;
+
+// Columns of the weather records - one vector per field so the device reads each column coalesced
+// Encoded to 7 bytes per record - station dictionary code, packed date and time and temperature in fixed point tenths
+struct record_columns
+{
+	vector<cl_uchar> station;
+	vector<cl_uint> timestamp;
+	vector<fixed_point> temperature;
+};
+
+// Mergeable moments of a set of temperatures
+struct moments
+{
+	cl_ulong count = 0;
+	double sum = 0.0;
+	double m2 = 0.0;
+	floating_point min = FLT_MAX;
+	floating_point max = -FLT_MAX;
+};
+
+// Aggregate state of the records up to an offset in the file - saved between runs
+// With the size and modification time of the file and a fingerprint of the bytes before the offset so the state of another file is not merged
+struct aggregate_state
+{
+	streamoff offset = 0;
+	cl_long source_size = -1;
+	cl_long source_modified = -1;
+	cl_ulong source_fingerprint = 0;
+	moments total;
+	vector<cl_ulong> histogram;
+	vector<moments> station_month;
+};
+
+// Moments of every station, year and month - saved next to the data file with the size and modification time of the file
+struct aggregate_cube
+{
+	cl_long source_size = -1;
+	cl_long source_modified = -1;
+	integer first_year = 0;
+	integer years = 0;
+	vector<moments> cells;
+};
+
+// Temperature column compressed in blocks - the minimum of each block as the frame of reference and the offsets from it bit packed
+// Cached with the size and modification time of the data file it was compressed from
+struct compressed_column
+{
+	cl_long source_size = -1;
+	cl_long source_modified = -1;
+	cl_uint count = 0;
+	cl_uint block_size = 0;
+	vector<fixed_point> reference;
+	vector<cl_uchar> bit_width;
+	vector<cl_uint> block_offset;
+	vector<cl_uint> words;
+};
+
+// Tree reduction of floats queued on a graph - the events and elements of its launches and the two partial buffers, the current one holds the result
+struct tree_reduction
+{
+	vector<cl::Event> events;
+	vector<size_t> launch_elements;
+	cl::Buffer buffer_partial[2];
+	int current = 0;
+};
+
+// Pool of device buffers - free buffers by size class
+struct buffer_pool
+{
+	map<size_t, vector<cl::Buffer>> free_buffers;
+	size_t allocations = 0;
+	size_t reuses = 0;
+	size_t allocated_bytes = 0;
+};
+
+// Peaks of the device - measured bandwidth in GB/s and theoretical compute in GFLOP/s, and the measured bandwidth of the transfers to and from the host
+struct device_peaks
+{
+	double bandwidth = 0.0;
+	double compute = 0.0;
+	double upload = 0.0;
+	double download = 0.0;
+};
+
+// Bounded lock free queue of many producers and consumers - each cell holds the lap it is free or full for (Vyukov)
+// A full queue rejects a push and an empty queue a pop so the callers decide how to wait
+template <typename T, size_t capacity>
+struct bounded_queue
+{
+	struct cell
+	{
+		atomic<size_t> sequence;
+		T data;
+	};
+	cell cells[capacity];
+	atomic<size_t> enqueue_position{ 0 };
+	atomic<size_t> dequeue_position{ 0 };
+
+	bounded_queue()
+	{
+		for (size_t i = 0; i < capacity; i++)
+			cells[i].sequence.store(i, memory_order_relaxed);
+	}
+
+	// Push a value - false if the queue is full
+	bool try_push(T &value)
+	{
+		size_t position = enqueue_position.load(memory_order_relaxed);
+		for (;;)
+		{
+			cell &target = cells[position % capacity];
+			ptrdiff_t difference = (ptrdiff_t)target.sequence.load(memory_order_acquire) - (ptrdiff_t)position;
+
+			// The cell is free for this lap - claim the position
+			if (difference == 0)
+			{
+				if (enqueue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+				{
+					target.data = move(value);
+					target.sequence.store(position + 1, memory_order_release);
+					return true;
+				}
+			}
+
+			// The cell still holds the value of the last lap
+			else if (difference < 0)
+				return false;
+
+			// Another producer claimed the position
+			else
+				position = enqueue_position.load(memory_order_relaxed);
+		}
+	}
+
+	// Pop a value - false if the queue is empty
+	bool try_pop(T &value)
+	{
+		size_t position = dequeue_position.load(memory_order_relaxed);
+		for (;;)
+		{
+			cell &target = cells[position % capacity];
+			ptrdiff_t difference = (ptrdiff_t)target.sequence.load(memory_order_acquire) - (ptrdiff_t)(position + 1);
+
+			// The cell is full for this lap - claim the position and free the cell for the next lap
+			if (difference == 0)
+			{
+				if (dequeue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+				{
+					value = move(target.data);
+					target.sequence.store(position + capacity, memory_order_release);
+					return true;
+				}
+			}
+
+			// Nothing pushed to the cell yet
+			else if (difference < 0)
+				return false;
+
+			// Another consumer claimed the position
+			else
+				position = dequeue_position.load(memory_order_relaxed);
+		}
+	}
+};
+
+// Compression of an input file
+enum input_compression { plain_text, gzip_compressed, zstd_compressed };
+
+// Query filter - every range is inclusive, a station of SIZE_MAX selects all stations
+struct record_filter
+{
+	bool active = false;
+	string station_name;
+	size_t station = SIZE_MAX;
+	cl_int2 year_range = { { INT_MIN, INT_MAX } };
+	cl_int2 month_range = { { INT_MIN, INT_MAX } };
+	cl_int2 day_range = { { INT_MIN, INT_MAX } };
+	cl_int2 time_range = { { INT_MIN, INT_MAX } };
+	cl_float2 temperature_range = { { -FLT_MAX, FLT_MAX } };
+};
 
 // ******************************************************************************************************************************************************************
 // **************************************************************************GLOBAL VARIABLES************************************************************************
@@ -43,6 +241,75 @@ const char* file = "temp_lincolnshire.txt";
 cl::Device device;
 size_t prefferSize = 0;
 
+// Station names - the index of a name is the station code stored in the records
+vector<string> station_names;
+
+// Query filter set from the command line
+record_filter query_filter;
+
+// Benchmark the scan primitive
+bool run_scan_benchmark = false;
+
+// Rolling window lengths - number of readings per station
+vector<size_t> rolling_windows;
+
+// Aggregate state file of the incremental mode
+string state_file;
+
+// Answer the query filter from the station, year and month cube
+bool run_cube = false;
+
+// Bootstrap replicates - 0 to skip the confidence intervals - and the seed of their resampling
+size_t bootstrap_replicates = 0;
+cl_ulong bootstrap_seed = (cl_ulong)chrono::system_clock::now().time_since_epoch().count();
+
+// Pipelined ingest - parse, upload and reduce the chunks of the file concurrently
+bool run_pipeline = false;
+
+// Report the achieved bandwidth and compute of the kernels against the peaks of the device
+bool run_roofline = false;
+device_peaks peaks;
+
+// Store the float column as halfs on device
+bool half_storage = false;
+
+// Also reduce the full precision column to validate the half storage
+bool validate_half = false;
+
+// Binary cache of the compressed temperatures
+string compressed_cache_file;
+
+// Input files of the batched mode - one dataset per file
+vector<string> batch_files;
+
+// Number of hottest and coldest records to report - 0 to skip the extremes
+size_t extreme_records = 0;
+
+// Z-score over which a reading is an anomaly - 0 to skip the anomalies
+floating_point anomaly_threshold = 0.0f;
+
+// Correlate the temperatures of every pair of stations
+bool run_correlation = false;
+
+// Thresholds over which a reading is hot - frost readings and spells are counted with any of them
+vector<floating_point> hot_thresholds;
+
+// 64 bit atomics of the device - the features that need them are skipped on a device without them
+bool int64_base_atomics = false;
+bool int64_extended_atomics = false;
+
+// Days either side of a day of the year pooled into its baseline
+const integer baseline_half_window = 7;
+
+// Device buffers and kernels shared by all statistics and queries
+buffer_pool device_buffers;
+map<string, cl::Kernel> kernel_cache;
+
+// Histogram of the temperatures multiplied by 10 - first bin, bin width and number of bins
+const integer histogram_min = -400;
+const integer histogram_bin_width = 10;
+const integer histogram_bins = 90;
+
 // ******************************************************************************************************************************************************************
 // ************************************************************************FUNCTION PROTOITYPES**********************************************************************
 // ******************************************************************************************************************************************************************
@@ -57,23 +324,226 @@ vector<floating_point> load_file_float(const char* file);
 floating_point parse_string_to_float(string line);
 
 // Load file function
-vector<integer> load_file_int(const char* file);
+vector<fixed_point> load_file_int(const char* file);
 
 // Parse each line of the file
-integer parse_string_to_int(string line);
+fixed_point parse_string_to_int(string line);
+
+// Load file function - all columns from an offset in the file, the end offset is returned if requested
+record_columns load_file_records(const char* file, streamoff start_offset = 0, streamoff* end_offset = nullptr);
+
+// Parse each line of the file into the record columns
+void parse_string_to_record(string line, record_columns &records);
+
+// Compression of a file - detected from its first bytes
+input_compression detect_compression(const char* file);
+
+// Decompress a file in blocks and push them to the queue - on its own thread, until the end of the file or the reader stops
+void decompress_blocks(const char* file, input_compression compression, bounded_queue<string, 8> &blocks, atomic<bool> &done, atomic<bool> &stop);
+
+// Read each line of a file - decompressed on the fly if compressed - false if the file cannot be read
+bool read_lines(const char* file, const function<void(const string&)> &process_line);
+
+// Order the records by station and time
+record_columns order_records(const record_columns &records);
+
+// Pack a date and time into a timestamp - year 12 bits, month 4 bits, day 5 bits, hour 5 bits, minute 6 bits
+cl_uint pack_timestamp(integer year, integer month, integer day, integer time);
+
+// Unpack the fields of a timestamp - the time of day as hhmm
+integer timestamp_year(cl_uint timestamp);
+integer timestamp_month(cl_uint timestamp);
+integer timestamp_day(cl_uint timestamp);
+integer timestamp_time(cl_uint timestamp);
+
+// Round a value up to a multiple
+size_t round_up(size_t value, size_t multiple);
+
+// Out of order queue for commands linked by events - in order if the device does not support it
+cl::CommandQueue create_graph_queue(cl::Context &context);
+
+// Whether the device supports the extension of a feature - the feature is reported as skipped otherwise
+bool device_supports(bool supported, const char* extension, const char* feature);
+
+// ********************************************************************************POOLS*****************************************************************************
+
+// Size class of a buffer - eight classes between powers of two
+size_t size_class(size_t size);
+
+// Device buffer of at least the size - reused from the pool if one of its size class is free
+cl::Buffer acquire_buffer(cl::Context &context, size_t size);
+
+// Return a buffer to the pool
+void release_buffer(cl::Buffer &buffer);
+
+// Kernel of the program - created on first use and reused
+cl::Kernel &cached_kernel(cl::Program &program, const string &name);
+
+// *******************************************************************************FILTERS****************************************************************************
+
+// Select the records matching the query filter on device and compact their temperatures
+size_t filter_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size, cl::Buffer &buffer_selected, cl::Buffer &buffer_selected_int);
+
+// Records matching the query filter - all columns, in the order of the file
+record_columns select_records(const record_columns &records);
+
+// ********************************************************************************SCANS*****************************************************************************
+
+// Inclusive or exclusive scan of a buffer of any length - returns the kernel execution time
+template <typename T>
+cl_ulong parallel_scan(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, cl::Buffer &buffer_output, size_t elements, size_t local_size, bool inclusive, const string &type_name);
+
+// Queue one level of the scan and the levels of its block sums - the events and pooled block buffers are appended
+template <typename T>
+void enqueue_scan(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, cl::Buffer &buffer_output, size_t elements, size_t local_size, bool inclusive,
+	const string &type_name, vector<cl::Event> &events_profiling, vector<cl::Buffer> &block_buffers);
+
+// Benchmark the device scan against the host scan
+template <typename T>
+void scan_benchmark(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, vector<T> &input, size_t local_size, const string &type_name);
+
+// ***************************************************************************ROLLING WINDOWS************************************************************************
+
+// Rolling mean, standard deviation, min and max per station - written to a csv file
+void rolling_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t window, size_t local_size);
+
+// ******************************************************************************INCREMENTAL*************************************************************************
+
+// Merge the moments of two sets of temperatures
+void merge_moments(moments &total, const moments &partial);
+
+// Merge two aggregate states
+void merge_aggregate_state(aggregate_state &total, const aggregate_state &partial);
+
+// Load the aggregate state - false if there is no saved state
+bool load_aggregate_state(const string &file, aggregate_state &state);
+
+// Save the aggregate state
+void save_aggregate_state(const string &file, const aggregate_state &state);
+
+// Fingerprint of the bytes of the data file before an offset - FNV-1a of up to the last 4 KB
+cl_ulong source_fingerprint(const char* file, streamoff offset);
+
+// Check the saved state belongs to the data file - it was not truncated or rewritten since
+bool state_matches_source(const char* file, const aggregate_state &state);
+
+// Reduce the records into an aggregate state on device
+aggregate_state grouped_moments_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size);
+
+// Reduce the records appended since the saved state and merge them into it
+void incremental_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size);
+
+// *********************************************************************************CUBE*****************************************************************************
+
+// Size and modification time of the data file - the cube is rebuilt when either changes
+void source_signature(const char* file, cl_long &size, cl_long &modified);
+
+// Load the aggregate cube - false if there is no cube of the current data file
+bool load_aggregate_cube(const string &file, aggregate_cube &cube);
+
+// Save the aggregate cube
+void save_aggregate_cube(const string &file, const aggregate_cube &cube);
+
+// Reduce the records into the station, year and month cells of a cube on device
+aggregate_cube cube_moments_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size);
+
+// Answer the query filter by merging the cells of the cube - the cube is built and saved next to the data file if missing or stale
+void cube_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size);
+
+// ******************************************************************************COMPRESSION*************************************************************************
+
+// Compress the fixed point temperatures in blocks - frame of reference plus bit packed offsets
+compressed_column compress_temperatures(const vector<fixed_point> &temperatures, size_t block_size);
+
+// Load the compressed column - false if there is no cache of the current data file
+bool load_compressed_column(const string &file, compressed_column &column);
+
+// Save the compressed column
+void save_compressed_column(const string &file, const compressed_column &column);
+
+// Reduce the compressed temperatures - decompressed on device
+void compressed_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size);
+
+// ******************************************************************************DATASETS****************************************************************************
+
+// Reduce every input file in a single segmented launch - one row of the results table per file
+void batch_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size);
+
+// ******************************************************************************EXTREMES****************************************************************************
+
+// Station, date and time of a record
+string describe_record(const record_columns &records, size_t index);
+
+// Records of the extreme temperatures - arg max and arg min from packed keys and the k hottest and coldest records
+void extremes_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t k, size_t local_size);
+
+// ******************************************************************************ANOMALIES***************************************************************************
+
+// Readings unusual for their station and time of year - written to a csv file
+void anomaly_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, floating_point threshold, size_t local_size);
+
+// ****************************************************************************CORRELATIONS**************************************************************************
+
+// Stable radix sort of the keys and their values on device - 4 bit digits from the scan of the digit histograms
+cl_ulong radix_sort(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_keys, cl::Buffer &buffer_values, size_t count, integer bits, size_t local_size);
+
+// Correlation of the temperatures of every pair of stations over their readings at the same times - written to a csv file
+void correlation_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size);
+
+// *******************************************************************************ROOFLINE***************************************************************************
+
+// Measure the peak bandwidth of the device with the STREAM copy kernel, its theoretical compute from the compute units and clock and the bandwidth of the transfers
+void measure_device_peaks(cl::Context &context, cl::CommandQueue &queue, cl::Program &program);
+
+// Achieved bandwidth and compute of a kernel against the peaks of the device
+void roofline_report(const string &name, cl_ulong execution_time, double bytes, double operations);
+
+// Achieved bandwidth of a transfer against the measured bandwidth of the transfers in its direction
+void transfer_report(const string &name, cl_ulong transfer_time, double bytes, bool upload);
+
+// Sum of the profiled times of a set of commands
+cl_ulong profiled_time(const vector<cl::Event> &events);
+
+// *******************************************************************************PIPELINE***************************************************************************
+
+// Parse the records starting in a byte range of the file into chunks of temperatures and push them to the queue
+void parse_range(const char* file, streamoff begin, streamoff end, size_t chunk_records, bounded_queue<vector<fixed_point>, 8> &chunks, cl_ulong &parse_time);
+
+// Pipelined ingest - parser threads, the upload of each chunk and its reduction overlap
+void pipeline_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size);
+
+// ******************************************************************************BOOTSTRAP***************************************************************************
+
+// Percentile bootstrap confidence intervals of the mean and standard deviation - the replicates are resampled on device
+void bootstrap_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t records_count, size_t replicates, cl_ulong seed, size_t local_size);
+
+// *******************************************************************************SPELLS*****************************************************************************
+
+// Frost and hot readings of every station and year and their longest spells - written to a csv file
+void spell_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, const vector<floating_point> &hot_thresholds, size_t local_size);
 
 // *******************************************************************************FLOATS*****************************************************************************
 
 // Floating point kernel calls
 void floating_point_kernel_calls(size_t input_size, cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, vector<floating_point> air_temperatures, size_t local_size);
 
-// Reduction float max value
-void float_reduction(cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t local_size);
+// Reduction floats - the input is stored as halfs in the half storage mode
+moments float_reduction(cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t local_size, bool half_input = false);
+
+// Convert a float to a half - round to nearest even
+cl_half float_to_half(floating_point value);
+
+// Queue the reduction of a buffer of floats to a single value behind the wait list - the first pass with the given kernel, the partial results with the partial kernel
+void enqueue_float_tree_reduction(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t input_elements, size_t local_size,
+	cl::Kernel &kernel_first, const string &partial_kernel, const vector<cl::Event> &wait_list, tree_reduction &tree);
+
+// Display the launches of a completed tree reduction - returns the sum of their execution times
+cl_ulong report_float_tree_reduction(const tree_reduction &tree, size_t local_size, size_t input_element_size, integer first_operations);
 
 // *****************************************************************************INTEGERS*****************************************************************************
 
 // Integers kernel calls
-void integer_kernel_calls(size_t input_size, cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, vector<integer> air_temperatures, size_t local_size);
+void integer_kernel_calls(size_t input_size, cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, vector<fixed_point> air_temperatures, size_t local_size);
 
 // Reduction integers
 void integer_reduction(cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t local_size);
@@ -110,6 +580,127 @@ int main(int argc, char **argv)
 		// Print help to console
 		else if (strcmp(argv[i], "-h") == 0)
 			print_help();
+
+		// Benchmark the scan primitive
+		else if (strcmp(argv[i], "-scan") == 0)
+			run_scan_benchmark = true;
+
+		// Rolling window statistics
+		else if ((strcmp(argv[i], "-rolling") == 0) && (i < (argc - 1)))
+		{
+			int window = atoi(argv[++i]);
+			if (window > 0) rolling_windows.push_back(window);
+		}
+
+		// Incremental mode - only reduce the records appended since the saved state
+		else if ((strcmp(argv[i], "-append") == 0) && (i < (argc - 1)))
+			state_file = argv[++i];
+
+		// Compressed mode - reduce the temperatures from a compressed binary cache
+		else if ((strcmp(argv[i], "-compressed") == 0) && (i < (argc - 1)))
+			compressed_cache_file = argv[++i];
+
+		// Records of the extreme temperatures - the k hottest and coldest
+		else if ((strcmp(argv[i], "-extremes") == 0) && (i < (argc - 1)))
+		{
+			int k = atoi(argv[++i]);
+			if (k > 0) extreme_records = k;
+		}
+
+		// Anomalies against the station and day of the year baseline
+		else if ((strcmp(argv[i], "-anomalies") == 0) && (i < (argc - 1)))
+			anomaly_threshold = (floating_point)atof(argv[++i]);
+
+		// Bootstrap confidence intervals of the mean and standard deviation
+		else if ((strcmp(argv[i], "-bootstrap") == 0) && (i < (argc - 1)))
+		{
+			int replicates = atoi(argv[++i]);
+			if (replicates > 0) bootstrap_replicates = replicates;
+		}
+
+		// Seed of the bootstrap - a fixed seed gives the same intervals on every run
+		else if ((strcmp(argv[i], "-seed") == 0) && (i < (argc - 1)))
+			bootstrap_seed = strtoull(argv[++i], nullptr, 10);
+
+		// Pipelined ingest mode
+		else if (strcmp(argv[i], "-pipeline") == 0)
+			run_pipeline = true;
+
+		// Roofline report of the kernels and transfers
+		else if (strcmp(argv[i], "-roofline") == 0)
+			run_roofline = true;
+
+		// Half storage mode - the float kernels read the temperatures as halfs
+		else if (strcmp(argv[i], "-half") == 0)
+			half_storage = true;
+
+		// Validate the half storage mode against full precision
+		else if (strcmp(argv[i], "-validate") == 0)
+			validate_half = true;
+
+		// Cube mode - roll-ups of the query filter from the station, year and month cube
+		else if (strcmp(argv[i], "-cube") == 0)
+			run_cube = true;
+
+		// Correlation of the stations over their readings at the same times
+		else if (strcmp(argv[i], "-correlation") == 0)
+			run_correlation = true;
+
+		// Frost and hot readings and spells - one hot threshold per option
+		else if ((strcmp(argv[i], "-spells") == 0) && (i < (argc - 1)))
+			hot_thresholds.push_back((floating_point)atof(argv[++i]));
+
+		// Batched mode - every file up to the next option is a dataset
+		else if (strcmp(argv[i], "-files") == 0)
+			while ((i < (argc - 1)) && (argv[i + 1][0] != '-'))
+				batch_files.push_back(argv[++i]);
+
+		// Filter on a station
+		else if ((strcmp(argv[i], "-station") == 0) && (i < (argc - 1)))
+		{
+			query_filter.station_name = argv[++i];
+			query_filter.active = true;
+		}
+
+		// Filter on a range of years
+		else if ((strcmp(argv[i], "-year") == 0) && (i < (argc - 2)))
+		{
+			query_filter.year_range.s[0] = atoi(argv[++i]);
+			query_filter.year_range.s[1] = atoi(argv[++i]);
+			query_filter.active = true;
+		}
+
+		// Filter on a range of months
+		else if ((strcmp(argv[i], "-month") == 0) && (i < (argc - 2)))
+		{
+			query_filter.month_range.s[0] = atoi(argv[++i]);
+			query_filter.month_range.s[1] = atoi(argv[++i]);
+			query_filter.active = true;
+		}
+
+		// Filter on a range of days
+		else if ((strcmp(argv[i], "-day") == 0) && (i < (argc - 2)))
+		{
+			query_filter.day_range.s[0] = atoi(argv[++i]);
+			query_filter.day_range.s[1] = atoi(argv[++i]);
+			query_filter.active = true;
+		}
+
+		// Filter on a range of times of day - hhmm
+		else if ((strcmp(argv[i], "-time") == 0) && (i < (argc - 2)))
+		{
+			query_filter.time_range.s[0] = atoi(argv[++i]);
+			query_filter.time_range.s[1] = atoi(argv[++i]);
+			query_filter.active = true;
+		}
+
+		// Filter on a range of temperatures
+		else if ((strcmp(argv[i], "-temp") == 0) && (i < (argc - 2)))
+		{
+			query_filter.temperature_range.s[0] = (floating_point)atof(argv[++i]);
+			query_filter.temperature_range.s[1] = (floating_point)atof(argv[++i]);
+			query_filter.active = true;
+		}
 	}
 #pragma endregion
 
@@ -119,11 +710,38 @@ int main(int argc, char **argv)
 		// Start of file reading
 		hi_res_time_point start_of_execution = hi_res_clock::now();
 
-		// Read in the data from the text file and parse
-		vector<floating_point> air_temperatures = load_file_float(file);
+		// Temperatures and - for filtered queries - all record columns
+		vector<floating_point> air_temperatures;
+		vector<fixed_point> air_temperatures_int;
+		record_columns records;
 
-		// Read in the data from the text file and parse
-		vector<integer> air_temperatures_int = load_file_int(file);
+		// The incremental mode only reads the records appended since the saved state - the compressed, batched, cube and pipelined modes read their own input
+		bool reads_own_input = !state_file.empty() || !compressed_cache_file.empty() || !batch_files.empty() || run_cube || run_pipeline;
+
+		// Read in the data file for all other modes
+		if (!reads_own_input)
+		{
+			// Read in all columns of the data - filters, rolling windows, extremes, anomalies, correlations and spells need the stations and times
+			if (query_filter.active || !rolling_windows.empty() || extreme_records || anomaly_threshold > 0.0f || run_correlation || !hot_thresholds.empty())
+			{
+				records = load_file_records(file);
+				air_temperatures_int = records.temperature;
+
+				// Decode the fixed point temperatures for the float kernels
+				for (fixed_point temperature : air_temperatures_int)
+					air_temperatures.push_back(temperature / 10.0f);
+			}
+
+			// Read in only the temperatures
+			else
+			{
+				// Read in the data from the text file and parse
+				air_temperatures = load_file_float(file);
+
+				// Read in the data from the text file and parse
+				air_temperatures_int = load_file_int(file);
+			}
+		}
 
 		// Time taken to read and parse the file - converted to seconds
 		auto time_elapsed_read_and_parse = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_execution).count() / milli_to_seconds;
@@ -142,6 +760,9 @@ int main(int argc, char **argv)
 		// Create a queue to which we will push commands for the device
 		cl::CommandQueue queue(context, CL_QUEUE_PROFILING_ENABLE);
 
+		// Create a queue for the commands linked by events
+		cl::CommandQueue graph_queue = create_graph_queue(context);
+
 		// Load & build the device code
 		cl::Program::Sources sources;
 		AddSources(sources, "kernels.cl");
@@ -162,6 +783,15 @@ int main(int argc, char **argv)
 			throw err;
 		}
 
+		// 64 bit atomics of the device - their kernels are only in the program if supported
+		string device_extensions = context.getInfo<CL_CONTEXT_DEVICES>()[0].getInfo<CL_DEVICE_EXTENSIONS>();
+		int64_base_atomics = device_extensions.find("cl_khr_int64_base_atomics") != string::npos;
+		int64_extended_atomics = device_extensions.find("cl_khr_int64_extended_atomics") != string::npos;
+
+		// Peaks of the device for the roofline report
+		if (run_roofline)
+			measure_device_peaks(context, queue, program);
+
 		// The following part adjusts the length of the input vector so it can be run for a specific workgroup size
 		// If the total input length is divisible by the workgroup size
 		// This makes the code more efficient
@@ -181,19 +811,93 @@ int main(int argc, char **argv)
 			air_temperatures_int.insert(air_temperatures_int.end(), air_temperatures_ext.begin(), air_temperatures_ext.end());
 		}
 
+		// Reduce only the appended records and merge them into the saved state
+		if (!state_file.empty())
+		{
+			// Display 
+			cout << "\n\nINCREMENTAL KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_base_atomics, "cl_khr_int64_base_atomics", "INCREMENTAL MODE"))
+				incremental_kernel_calls(context, queue, program, local_size);
+			return 0;
+		}
+
+		// Reduce the compressed temperatures
+		if (!compressed_cache_file.empty())
+		{
+			// Display 
+			cout << "\n\nCOMPRESSED KERNEL CALLS\n\n" << endl;
+
+			compressed_kernel_calls(context, queue, program, local_size);
+			return 0;
+		}
+
+		// Reduce every input file in a single launch
+		if (!batch_files.empty())
+		{
+			// Display 
+			cout << "\n\nBATCHED KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_base_atomics, "cl_khr_int64_base_atomics", "BATCHED MODE"))
+				batch_kernel_calls(context, queue, program, local_size);
+			return 0;
+		}
+
+		// Roll-ups of the query filter from the cube
+		if (run_cube)
+		{
+			// Display 
+			cout << "\n\nCUBE KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_base_atomics, "cl_khr_int64_base_atomics", "CUBE MODE"))
+				cube_kernel_calls(context, queue, program, local_size);
+			return 0;
+		}
+
+		// Parse, upload and reduce the file in overlapping chunks
+		if (run_pipeline)
+		{
+			// Display 
+			cout << "\n\nPIPELINED KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_base_atomics, "cl_khr_int64_base_atomics", "PIPELINED MODE"))
+				pipeline_kernel_calls(context, graph_queue, program, local_size);
+			return 0;
+		}
+
 		// Number of input elements
 		size_t input_elements = air_temperatures.size();
 
 		// Size in bytes
 		size_t input_size_float = air_temperatures.size() * sizeof(floating_point);
-		size_t input_size_int = air_temperatures_int.size() * sizeof(integer);
+		size_t input_size_int = air_temperatures_int.size() * sizeof(fixed_point);
 
 		// Number of groups
 		size_t nr_groups = input_elements / local_size;
 
-		// Device - input buffer
-		cl::Buffer buffer_input(context, CL_MEM_READ_ONLY, input_size_float);
-		cl::Buffer buffer_input_int(context, CL_MEM_READ_ONLY, input_size_int);
+		// Device - input buffers of the records selected by the query filter
+		cl::Buffer buffer_selected;
+		cl::Buffer buffer_selected_int;
+
+		// Evaluate the query filter on device
+		if (query_filter.active)
+		{
+			// Display 
+			cout << "\n\nFILTER KERNEL CALLS\n\n" << endl;
+
+			// Compact the selected temperatures - the reductions then only see the selected records
+			number_of_data_entries = filter_kernel_calls(context, queue, program, records, local_size, buffer_selected, buffer_selected_int);
+
+			// Nothing to reduce
+			if (!number_of_data_entries)
+			{
+				cout << "No records match the query" << endl;
+				return 0;
+			}
+
+			// Number of input elements of the selected records
+			input_elements = round_up(number_of_data_entries, local_size);
+		}
 
 		// Start fo float kernels
 		hi_res_time_point start_of_float_execution = hi_res_clock::now();
@@ -201,8 +905,16 @@ int main(int argc, char **argv)
 		// Display 
 		cout << "\n\nFLOAT KERNEL CALLS\n\n" << endl;
 
-		// Execute the floating point kernels
-		floating_point_kernel_calls(input_size_float, context, input_elements, queue, program, air_temperatures, local_size);
+		// Execute the floating point kernels - on the selected records if filtered
+		// The filter compacts the selection on device at full precision - there is no half column to upload
+		if (query_filter.active)
+		{
+			if (half_storage)
+				cout << "HALF STORAGE IGNORED - the records selected by the query filter are compacted on device as floats" << endl;
+			float_reduction(context, input_elements, graph_queue, program, buffer_selected, local_size);
+		}
+		else
+			floating_point_kernel_calls(input_size_float, context, input_elements, graph_queue, program, air_temperatures, local_size);
 
 		// Time taken to execute float kernels - converted to seconds
 		auto time_elapsed_float_kernels = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_float_execution).count() / milli_to_seconds;
@@ -213,12 +925,118 @@ int main(int argc, char **argv)
 		// Display 
 		cout << "\n\nINTEGER KERNEL CALLS\n\n" << endl;
 
-		// Execute the integer kernels
-		integer_kernel_calls(input_size_int, context, input_elements, queue, program, air_temperatures_int, local_size);
+		// Execute the integer kernels - on the selected records if filtered
+		// The reductions run as a graph on the out of order queue
+		if (query_filter.active)
+			integer_reduction(context, input_elements, graph_queue, program, buffer_selected_int, local_size);
+		else
+			integer_kernel_calls(input_size_int, context, input_elements, graph_queue, program, air_temperatures_int, local_size);
 
 		// Time taken to execute float kernels - converted to seconds
 		auto time_elapsed_int_kernels = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_int_execution).count() / milli_to_seconds;
+
+		// Benchmark the scan for every type on the temperatures
+		if (run_scan_benchmark)
+		{
+			// Display 
+			cout << "\n\nSCAN BENCHMARK\n\n" << endl;
+
+			// Fixed point temperatures as ints and longs
+			vector<integer> scan_input_int(air_temperatures.size());
+			for (size_t i = 0; i < air_temperatures.size(); i++) scan_input_int[i] = (integer)lround(air_temperatures[i] * 10);
+			vector<cl_long> scan_input_long(scan_input_int.begin(), scan_input_int.end());
+
+			scan_benchmark(context, queue, program, scan_input_int, local_size, "int");
+			scan_benchmark(context, queue, program, air_temperatures, local_size, "float");
+			scan_benchmark(context, queue, program, scan_input_long, local_size, "long");
+		}
 		
+		// Records of the query filter for the statistics that need all columns - all records if not filtered
+		record_columns filtered_records;
+		if (query_filter.active && (extreme_records || anomaly_threshold > 0.0f || run_correlation || !hot_thresholds.empty() || !rolling_windows.empty()))
+			filtered_records = select_records(records);
+		record_columns &selected_records = query_filter.active ? filtered_records : records;
+
+		// Records of the extreme temperatures - of the selected records if filtered
+		if (extreme_records)
+		{
+			// Display 
+			cout << "\n\nEXTREMES KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_extended_atomics, "cl_khr_int64_extended_atomics", "EXTREMES"))
+				extremes_kernel_calls(context, queue, program, selected_records, extreme_records, local_size);
+		}
+
+		// Anomalies against the station and day of the year baseline - of the selected records if filtered
+		if (anomaly_threshold > 0.0f)
+		{
+			// Display 
+			cout << "\n\nANOMALY KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_base_atomics, "cl_khr_int64_base_atomics", "ANOMALIES"))
+				anomaly_kernel_calls(context, queue, program, selected_records, anomaly_threshold, local_size);
+		}
+
+		// Correlation of every pair of stations - of the selected records if filtered
+		if (run_correlation)
+		{
+			// Display 
+			cout << "\n\nCORRELATION KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_base_atomics, "cl_khr_int64_base_atomics", "CORRELATIONS"))
+				correlation_kernel_calls(context, queue, program, selected_records, local_size);
+		}
+
+		// Frost and hot readings and spells on the records ordered by station and time - of the selected records if filtered
+		if (!hot_thresholds.empty())
+		{
+			// Display 
+			cout << "\n\nSPELL KERNEL CALLS\n\n" << endl;
+
+			if (device_supports(int64_extended_atomics, "cl_khr_int64_extended_atomics", "SPELLS"))
+			{
+				record_columns ordered_records = order_records(selected_records);
+				spell_kernel_calls(context, queue, program, ordered_records, hot_thresholds, local_size);
+			}
+		}
+
+		// Bootstrap confidence intervals - of the selected records if filtered
+		if (bootstrap_replicates)
+		{
+			// Display 
+			cout << "\n\nBOOTSTRAP KERNEL CALLS\n\n" << endl;
+
+			if (query_filter.active)
+				bootstrap_kernel_calls(context, queue, program, buffer_selected_int, number_of_data_entries, bootstrap_replicates, bootstrap_seed, local_size);
+			else
+			{
+				cl::Buffer buffer_input = acquire_buffer(context, input_size_int);
+				cl::Event event_write;
+				queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size_int, &air_temperatures_int[0], NULL, &event_write);
+				bootstrap_kernel_calls(context, queue, program, buffer_input, number_of_data_entries, bootstrap_replicates, bootstrap_seed, local_size);
+				transfer_report("bootstrap input upload", event_write.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_write.getProfilingInfo<CL_PROFILING_COMMAND_START>(), (double)input_size_int, true);
+				release_buffer(buffer_input);
+			}
+		}
+
+		// Rolling window statistics on the records ordered by station and time - of the selected records if filtered, the windows hold the selected readings
+		if (!rolling_windows.empty())
+		{
+			// Display 
+			cout << "\n\nROLLING WINDOW KERNEL CALLS\n\n" << endl;
+
+			record_columns ordered_records = order_records(selected_records);
+			for (size_t window : rolling_windows)
+				rolling_kernel_calls(context, queue, program, ordered_records, window, local_size);
+		}
+
+		// Return the selected records to the pool
+		if (query_filter.active)
+		{
+			release_buffer(buffer_selected);
+			release_buffer(buffer_selected_int);
+		}
+
 		// Time taken to execute kernels - converted to seconds
 		auto time_elapsed_kernel = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_execution).count() / milli_to_seconds;
 
@@ -230,6 +1048,13 @@ int main(int argc, char **argv)
 		cout << "Number of data entries: \t\t\t\t|| "				<< number_of_data_entries													<< endl;
 		cout << "Preffered work group size: \t\t\t\t|| "			<< prefferSize																<< endl;
 		cout << "Work group size:  \t\t\t\t\t|| "					<< local_size																<< endl;
+		cout << "Device buffers allocated / reused:  \t\t\t|| "	<< device_buffers.allocations << " / " << device_buffers.reuses				<< endl;
+		cout << "Device buffer memory allocated:  \t\t\t|| "		<< device_buffers.allocated_bytes							<< " bytes"		<< endl;
+		if (run_roofline)
+		{
+			cout << "Peak bandwidth / compute:  \t\t\t\t|| "	<< peaks.bandwidth << " GB/s / " << peaks.compute			<< " GFLOP/s"	<< endl;
+			cout << "Host to device / device to host:  \t\t\t|| "	<< peaks.upload << " GB/s / " << peaks.download				<< " GB/s"		<< endl;
+		}
 		cout << "Time to read and parse the file:  \t\t\t|| "		<< time_elapsed_read_and_parse								<< " seconds"	<< endl;
 		cout << "Time to execute float kernels:  \t\t\t|| "			<< time_elapsed_float_kernels								<< " seconds"	<< endl;
 		cout << "Time to execute integer kernels:  \t\t\t|| "		<< time_elapsed_int_kernels									<< " seconds"	<< endl;
@@ -261,6 +1086,30 @@ void print_help()
 	cerr << "  -d : select device" << endl;
 	cerr << "  -l : list all platforms and devices" << endl;
 	cerr << "  -h : print this message" << endl;
+	cerr << "  -scan : benchmark the device scan against the host scan" << endl;
+	cerr << "  -rolling <readings> : rolling statistics per station over a window of readings - written to rolling_<readings>.csv" << endl;
+	cerr << "  -append <state file> : only reduce the records appended since the saved state and merge them into it" << endl;
+	cerr << "  -compressed <cache file> : reduce the temperatures from a block compressed cache - created from the file if missing or out of date" << endl;
+	cerr << "  -files <file> <file> ... : reduce every file in a single launch and display a table of the results" << endl;
+	cerr << "  -extremes <k> : station, date and time of the max and min temperatures and the k hottest and coldest records" << endl;
+	cerr << "  -anomalies <z-score> : readings further from their station and day of the year baseline - written to anomalies.csv" << endl;
+	cerr << "  -bootstrap <replicates> : 95% percentile confidence intervals of the mean and standard deviation - resampled on device" << endl;
+	cerr << "  -seed <seed> : seed of the bootstrap resampling - reproducible intervals" << endl;
+	cerr << "  Input files compressed with gzip or zstd are decompressed on the fly" << endl;
+	cerr << "  -pipeline : parse, upload and reduce chunks of the file concurrently - fixed point moments of the temperatures" << endl;
+	cerr << "  -roofline : achieved bandwidth and compute of every kernel against the measured peaks of the device" << endl;
+	cerr << "              and of every transfer against the measured host to device and device to host bandwidth" << endl;
+	cerr << "  -half : store the temperatures as halfs for the float kernels - half the device memory and bandwidth of the floats, not with a query filter" << endl;
+	cerr << "  -validate : with -half, also reduce the full precision temperatures and compare the results" << endl;
+	cerr << "  -cube : answer the station, year and month filters from a cube of moments - built next to the data file when it changes" << endl;
+	cerr << "  -correlation : correlation of the temperatures of every pair of stations at the same times - written to correlation.csv" << endl;
+	cerr << "  -spells <temperature> : frost readings and readings over the temperature and their longest spells per station and year - repeat for more thresholds, written to spells.csv" << endl;
+	cerr << "  -station <name> : only analyse the records of a station" << endl;
+	cerr << "  -year <from> <to> : only analyse the records between two years" << endl;
+	cerr << "  -month <from> <to> : only analyse the records between two months" << endl;
+	cerr << "  -day <from> <to> : only analyse the records between two days of the month" << endl;
+	cerr << "  -time <from> <to> : only analyse the records between two times of day - hhmm" << endl;
+	cerr << "  -temp <from> <to> : only analyse the records between two temperatures" << endl;
 }
 
 // Load file function
@@ -269,27 +1118,14 @@ vector<floating_point> load_file_float(const char* file)
 	// Vector of int for air temperature
 	vector<floating_point> temperatures;
 
-	// Input file stream
-	ifstream ifs;
-
-	// The read data
-	string read_data;
-
-	// Each line of the file
-	string line;
-
-	// If the directory exsists - open it
-	if (file != nullptr)
-		ifs.open(file);
-
-	// If the stream is open
-	// get each line and add it to the data string
-	if (ifs.is_open())
-		while (getline(ifs, line))
-			temperatures.push_back(parse_string_to_float(line));
+	// Get each line - decompressed on the fly if the file is compressed - and add it to the data, an unreadable file stops the program
+	if (!read_lines(file, [&](const string &line) { temperatures.push_back(parse_string_to_float(line)); }))
+	{
+		cerr << "Cannot read the input file: " << (file != nullptr ? file : "") << endl;
+		exit(1);
+	}
 
-	// Close the stream and return the data
-	ifs.close();
+	// Return the data
 	return temperatures;
 }
 
@@ -334,40 +1170,27 @@ floating_point parse_string_to_float(string line)
 }
 
 // Load file function
-vector<integer> load_file_int(const char* file)
+vector<fixed_point> load_file_int(const char* file)
 {
 	// Vector of int for air temperature
-	vector<integer> temperatures;
+	vector<fixed_point> temperatures;
 
-	// Input file stream
-	ifstream ifs;
+	// Get each line - decompressed on the fly if the file is compressed - and add it to the data, an unreadable file stops the program
+	if (!read_lines(file, [&](const string &line) { temperatures.push_back(parse_string_to_int(line)); }))
+	{
+		cerr << "Cannot read the input file: " << (file != nullptr ? file : "") << endl;
+		exit(1);
+	}
 
-	// The read data
-	string read_data;
+	// Return the data
+	return temperatures;
+}
 
-	// Each line of the file
-	string line;
-
-	// If the directory exsists - open it
-	if (file != nullptr)
-		ifs.open(file);
-
-	// If the stream is open
-	// get each line and add it to the data string
-	if (ifs.is_open())
-		while (getline(ifs, line))
-			temperatures.push_back(parse_string_to_int(line));
-
-	// Close the stream and return the data
-	ifs.close();
-	return temperatures;
-}
-
-// Parse each line of the file
-integer parse_string_to_int(string line)
-{
-	// Air temperature
-	int temperature;
+// Parse each line of the file
+fixed_point parse_string_to_int(string line)
+{
+	// Air temperature
+	int temperature;
 
 	// Delimiter
 	char delimiter = ' ';
@@ -396,483 +1219,3380 @@ integer parse_string_to_int(string line)
 		}
 	}
 
-	// Convert and push the data to the vector
-	temperature = (int)(stof(number_to_string) * 10);
+	// Convert and push the data to the vector - rounded so every tenth is exact
+	temperature = (int)lround(stof(number_to_string) * 10);
 
 	// Return the vector of air temperatures
 	return temperature;
 }
 
-// *******************************************************************************FLOATS*****************************************************************************
-
-// Floating point kernel calls
-void floating_point_kernel_calls(size_t input_size, cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, vector<floating_point> air_temperatures, size_t local_size)
+// Load file function - all columns from an offset in the file, the end offset is returned if requested
+record_columns load_file_records(const char* file, streamoff start_offset, streamoff* end_offset)
 {
-	// Device - input buffer
-	cl::Buffer buffer_input(context, CL_MEM_READ_ONLY, input_size);
+	// Columns of the records
+	record_columns records;
 
-	// Copy temperatures arrays to and initialise other arrays on device memory
-	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &air_temperatures[0]);
+	// Input file stream - binary so the offsets are exact byte positions
+	ifstream ifs;
 
-	// Reduction max kernel call
-	float_reduction(context, input_elements, queue, program, buffer_input, local_size);
-}
+	// Each line of the file
+	string line;
 
-// Reduction floats
-void float_reduction(cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t local_size)
-{
-#pragma region REDUCTION MAX FLOATS
-	// Host - output
-	vector<floating_point> temperature_redux_max_result(input_elements);
+	// If the directory exsists - open it
+	if (file != nullptr)
+		ifs.open(file, ios::binary);
 
-	// Size in bytes
-	size_t output_size = temperature_redux_max_result.size() * sizeof(floating_point);
+	// An unreadable file stops the program
+	if (!ifs.is_open())
+	{
+		cerr << "Cannot read the input file: " << (file != nullptr ? file : "") << endl;
+		exit(1);
+	}
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_max(context, CL_MEM_READ_WRITE, output_size);
+	// Compressed input has no byte offsets of the records - it is read whole when nothing has been read from it yet
+	if (detect_compression(file) != plain_text)
+	{
+		if (!start_offset && !read_lines(file, [&](const string &line)
+			{
+				if (line.find_first_not_of(" \r") != string::npos)
+					parse_string_to_record(line, records);
+			}))
+		{
+			cerr << "Cannot read the input file: " << file << endl;
+			exit(1);
+		}
+	}
 
-	// Zero output buffers on device memory
-	queue.enqueueFillBuffer(buffer_output_redux_max, 0, 0, output_size);
+	// Skip to the offset, get each line and add it to the columns - empty lines are skipped
+	// A last line without a line break may still be being written - it is left for the next read when the end offset is returned
+	else
+	{
+		ifs.seekg(start_offset);
+		streamoff position = start_offset;
+		while (getline(ifs, line))
+		{
+			if (ifs.eof() && end_offset != nullptr) break;
+			position += (streamoff)line.size() + 1;
+			if (line.find_first_not_of(" \r") != string::npos)
+				parse_string_to_record(line, records);
+		}
 
-	// Assign an ulong for holding the execution time of kernels and int for kernel calls
-	cl_ulong execution_time;
-	cl_ulong transfer_time;
-	cl_ulong total_execution_time;
-	int kernel_launches = 1;
-	bool reduced = false;
+		// The end offset is just after the last line break read
+		if (end_offset != nullptr)
+			*end_offset = position;
+	}
 
-	// Dsiaply info
-	cout << "***********************************************************************************************************************************************" << endl;
-	cout << "MAX REDUCTION FLOATS" << endl;
+	// Compressed input is read whole - the end offset is the size of the file
+	if (end_offset != nullptr && detect_compression(file) != plain_text)
+	{
+		ifs.clear();
+		ifs.seekg(0, ios::end);
+		*end_offset = (streamoff)ifs.tellg();
+	}
 
-	// Kernel intialisation
-	cl::Kernel kernel_redux_max = cl::Kernel(program, "reduction_max");
-	kernel_redux_max.setArg(0, buffer_input);
-	kernel_redux_max.setArg(1, buffer_output_redux_max);
-	kernel_redux_max.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+	// Close the stream and return the data
+	ifs.close();
+	return records;
+}
 
-	// Call all kernels in a sequence
-	cl::Event event_redux_max_profiling;
-	cl::Event event_redux_max_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_max, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_max_profiling);
+// Compression of a file - detected from its first bytes
+input_compression detect_compression(const char* file)
+{
+	// Magic numbers of the formats
+	unsigned char magic[4] = { 0, 0, 0, 0 };
+	ifstream ifs(file, ios::binary);
+	ifs.read((char*)magic, sizeof(magic));
+
+	if (ifs.gcount() >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+		return gzip_compressed;
+	if (ifs.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+		return zstd_compressed;
+	return plain_text;
+}
 
-	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_max, CL_TRUE, 0, output_size, &temperature_redux_max_result[0], NULL, &event_redux_max_transfer);
+// Decompress a file in blocks and push them to the queue - on its own thread, until the end of the file or the reader stops
+// A gzip file of several members is decompressed member after member
+void decompress_blocks(const char* file, input_compression compression, bounded_queue<string, 8> &blocks, atomic<bool> &done, atomic<bool> &stop)
+{
+	bool failed = false;
 
-	// Display the profiling event data for the kernel
-	execution_time = event_redux_max_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_max_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_max_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_max_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	total_execution_time = execution_time;
-	cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+#if defined(USE_ZLIB) || defined(USE_ZSTD)
+	// Input file stream and the compressed and decompressed blocks
+	ifstream ifs(file, ios::binary);
+	vector<char> input(1 << 18);
+	string output;
+
+	// Push a decompressed block - a full queue waits for the reader
+	auto push_block = [&]()
+	{
+		while (!output.empty() && !blocks.try_push(output))
+		{
+			if (stop) { failed = true; return; }
+			this_thread::yield();
+		}
+		output.clear();
+	};
+#else
+	// No decompressor is built in - read_lines does not start the thread for a compressed file
+	(void)compression;
+	(void)blocks;
+#endif
 
-	// loop through workgroups and reduce
-	while(!reduced)
+#ifdef USE_ZLIB
+	if (compression == gzip_compressed)
 	{
-		// If the reduction is complete
-		if (temperature_redux_max_result[1] == 0.0f) break;/*reduced = true;*/
+		// 16 + the window bits - a gzip header and trailer
+		z_stream stream = {};
+		failed = inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK;
+		while (!failed)
+		{
+			ifs.read(&input[0], input.size());
+			stream.next_in = (Bytef*)&input[0];
+			stream.avail_in = (uInt)ifs.gcount();
+			if (!stream.avail_in) break;
+
+			// Inflate until the block is consumed and no output is pending
+			do
+			{
+				output.resize(1 << 20);
+				stream.next_out = (Bytef*)&output[0];
+				stream.avail_out = (uInt)output.size();
+				int status = inflate(&stream, Z_NO_FLUSH);
+				if (status == Z_STREAM_END) inflateReset(&stream);
+				else if (status != Z_OK && status != Z_BUF_ERROR) failed = true;
+				output.resize(output.size() - stream.avail_out);
+				push_block();
+			} while (!failed && (stream.avail_in || !stream.avail_out));
+		}
+		inflateEnd(&stream);
+	}
+#endif
 
-		kernel_redux_max.setArg(0, buffer_output_redux_max);
-		kernel_redux_max.setArg(1, buffer_output_redux_max);
-		kernel_redux_max.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+#ifdef USE_ZSTD
+	if (compression == zstd_compressed)
+	{
+		ZSTD_DStream* stream = ZSTD_createDStream();
+		ZSTD_initDStream(stream);
+		while (!failed)
+		{
+			ifs.read(&input[0], input.size());
+			ZSTD_inBuffer block_in = { &input[0], (size_t)ifs.gcount(), 0 };
+			if (!block_in.size) break;
+
+			// Decompress until the block is consumed and no output is pending
+			bool output_full = false;
+			do
+			{
+				output.resize(ZSTD_DStreamOutSize());
+				ZSTD_outBuffer block_out = { &output[0], output.size(), 0 };
+				size_t status = ZSTD_decompressStream(stream, &block_out, &block_in);
+				if (ZSTD_isError(status)) failed = true;
+				output.resize(block_out.pos);
+				output_full = block_out.pos == block_out.size;
+				push_block();
+			} while (!failed && (block_in.pos < block_in.size || output_full));
+		}
+		ZSTD_freeDStream(stream);
+	}
+#endif
 
-		// Call all kernels in a sequence
-		queue.enqueueNDRangeKernel(kernel_redux_max, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_max_profiling);
+	// The blocks pushed so far are still read
+	if (failed && !stop)
+		cerr << "Corrupt compressed input: " << file << endl;
+	done = true;
+}
 
-		// Copy the result from device to host
-		queue.enqueueReadBuffer(buffer_output_redux_max, CL_TRUE, 0, output_size, &temperature_redux_max_result[0], NULL, &event_redux_max_transfer);
+// Read each line of a file - decompressed on the fly if compressed - false if the file cannot be read
+// The decompression runs on its own thread so it overlaps the parsing of the lines
+bool read_lines(const char* file, const function<void(const string&)> &process_line)
+{
+	// No file
+	if (file == nullptr) return false;
+	input_compression compression = detect_compression(file);
 
-		// Display the profiling event data for the kernel
-		execution_time = event_redux_max_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_max_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-		transfer_time = event_redux_max_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_max_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-		total_execution_time += execution_time;
-		kernel_launches++;
-		cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+	// Plain text - get each line from the stream
+	if (compression == plain_text)
+	{
+		ifstream ifs(file);
+		if (!ifs.is_open()) return false;
+		string line;
+		while (getline(ifs, line))
+			process_line(line);
+		return true;
 	}
 
-	// Display the profiling event data for the kernel
-	cout << "Total reduction kernel luanches: " << kernel_launches << "\t|| Total time for " << kernel_launches << " executions [nano-seconds]: "	<< total_execution_time				<< endl;
-	cout << "MAX TEMPERATURE: "																														<< temperature_redux_max_result[0]	<< endl;
-	cout << "***********************************************************************************************************************************************"							<< endl;
-#pragma endregion
+	// Formats not built in
+#ifndef USE_ZLIB
+	if (compression == gzip_compressed)
+	{
+		cerr << "Reading gzip input needs a build with USE_ZLIB: " << file << endl;
+		return false;
+	}
+#endif
+#ifndef USE_ZSTD
+	if (compression == zstd_compressed)
+	{
+		cerr << "Reading zstd input needs a build with USE_ZSTD: " << file << endl;
+		return false;
+	}
+#endif
 
-#pragma region REDUCTION MIN FLOATS
-	// Host - output
-	vector<floating_point> temperature_redux_min_result(input_elements);
+	// Decompress on its own thread - the lines are cut from the blocks as they arrive, a line across two blocks is carried over
+	bounded_queue<string, 8> blocks;
+	atomic<bool> done{ false };
+	atomic<bool> stop{ false };
+	thread decompressor(decompress_blocks, file, compression, ref(blocks), ref(done), ref(stop));
+	string block, line;
+	try
+	{
+		for (;;)
+		{
+			// Next block - the flag is checked before the queue so no block pushed before the end is missed
+			bool finished = done.load();
+			if (!blocks.try_pop(block))
+			{
+				if (finished) break;
+				this_thread::yield();
+				continue;
+			}
+
+			// Every complete line of the block - carriage returns are dropped like a text mode stream
+			size_t start = 0;
+			for (size_t end = block.find('\n'); end != string::npos; start = end + 1, end = block.find('\n', start))
+			{
+				line.append(block, start, end - start);
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				process_line(line);
+				line.clear();
+			}
+			line.append(block, start, string::npos);
+		}
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_min(context, CL_MEM_READ_WRITE, output_size);
+		// Last line without a line break
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (!line.empty()) process_line(line);
+	}
 
-	// Assign an ulong for holding the execution time of kernels and int for kernel calls
-	execution_time = 0;
-	transfer_time = 0;
-	total_execution_time = 0;
-	kernel_launches = 1;
-	reduced = false;
+	// Stop the decompression before passing on a parsing error
+	catch (...)
+	{
+		stop = true;
+		decompressor.join();
+		throw;
+	}
+	decompressor.join();
+	return true;
+}
 
-	// Dsiaply info
-	cout << "***********************************************************************************************************************************************" << endl;
-	cout << "MIN REDUCTION FLOATS" << endl;
+// Parse each line of the file into the record columns
+void parse_string_to_record(string line, record_columns &records)
+{
+	// Delimiter
+	char delimiter = ' ';
 
-	// Kernel intialisation
-	cl::Kernel kernel_redux_min = cl::Kernel(program, "reduction_min");
-	kernel_redux_min.setArg(0, buffer_input);
-	kernel_redux_min.setArg(1, buffer_output_redux_min);
-	kernel_redux_min.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+	// Counter for the number of spaces in the line of text
+	int delimiter_count = 0;
 
-	// Call all kernels in a sequence
-	cl::Event event_redux_min_profiling;
-	cl::Event event_redux_min_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_min, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_min_profiling);
+	// Strings to hold the fields - station, year, month, day, time and temperature
+	string fields[6];
 
-	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_min, CL_TRUE, 0, output_size, &temperature_redux_min_result[0], NULL, &event_redux_min_transfer);
+	// Loop through the data in the string
+	for (size_t i = 0; i < line.length(); i++)
+	{
+		// If the data is a whitespace - move on to the next field
+		if (line[i] == delimiter && delimiter_count < 5) delimiter_count++;
 
-	// Display the profiling event data for the kernel
-	execution_time = event_redux_min_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_min_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_min_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_min_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	total_execution_time = execution_time;
-	cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+		// Else read in the field data
+		else fields[delimiter_count] += line[i];
+	}
 
-	// While the element at the local size position is not 0 reduce the min
-	while (!reduced)
+	// Look up the station code - add the station to the names if it is new
+	size_t station = find(station_names.begin(), station_names.end(), fields[0]) - station_names.begin();
+	if (station == station_names.size())
 	{
-		// If the reduction is complete
-		if (temperature_redux_min_result[1] == 0.0f) break; /*reduced = true;*/
+		// Station codes are a single byte
+		if (station > UCHAR_MAX)
+		{
+			cerr << "More than " << UCHAR_MAX + 1 << " stations in the file" << endl;
+			exit(1);
+		}
+		station_names.push_back(fields[0]);
+	}
 
-		kernel_redux_min.setArg(0, buffer_output_redux_min);
-		kernel_redux_min.setArg(1, buffer_output_redux_min);
-		kernel_redux_min.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+	// Encode and push the data to the columns - temperatures rounded to fixed point tenths
+	records.station.push_back((cl_uchar)station);
+	records.timestamp.push_back(pack_timestamp(stoi(fields[1]), stoi(fields[2]), stoi(fields[3]), stoi(fields[4])));
+	records.temperature.push_back((fixed_point)lround(stof(fields[5]) * 10));
+}
 
-		// Call all kernels in a sequence
-		queue.enqueueNDRangeKernel(kernel_redux_min, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_min_profiling);
+// Order the records by station and time - records with the same station and time keep their order in the file
+record_columns order_records(const record_columns &records)
+{
+	// Indices of the records
+	vector<size_t> order(records.temperature.size());
+	iota(order.begin(), order.end(), 0);
 
-		// Copy the result from device to host
-		queue.enqueueReadBuffer(buffer_output_redux_min, CL_TRUE, 0, output_size, &temperature_redux_min_result[0], NULL, &event_redux_min_transfer);
+	// Sort the indices by station and time - packed timestamps order as the dates and times
+	stable_sort(order.begin(), order.end(), [&records](size_t a, size_t b)
+	{
+		if (records.station[a] != records.station[b]) return records.station[a] < records.station[b];
+		return records.timestamp[a] < records.timestamp[b];
+	});
 
-		// Display the profiling event data for the kernel
-		execution_time = event_redux_min_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_min_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();	
-		transfer_time = event_redux_min_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_min_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-		total_execution_time += execution_time;
-		kernel_launches++;
-		cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+	// Gather the columns in order
+	record_columns ordered;
+	for (size_t i : order)
+	{
+		ordered.station.push_back(records.station[i]);
+		ordered.timestamp.push_back(records.timestamp[i]);
+		ordered.temperature.push_back(records.temperature[i]);
 	}
 
-	// Display the profiling event data for the kernel
-	cout << "Total reduction kernel luanches: " << kernel_launches << "\t|| Total time for " << kernel_launches << " executions [nano-seconds]: "	<< total_execution_time				<< endl;
-	cout << "MIN TEMPERATURE: "																														<< temperature_redux_min_result[0]	<< endl;
-	cout << "***********************************************************************************************************************************************"							<< endl;
-#pragma endregion
-
-#pragma region REDUCTION SUM FLOATS
-	// Host - output
-	vector<floating_point> temperature_redux_sum_result(input_elements);
+	return ordered;
+}
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_sum(context, CL_MEM_READ_WRITE, output_size);
+// Pack a date and time into a timestamp - year 12 bits, month 4 bits, day 5 bits, hour 5 bits, minute 6 bits
+cl_uint pack_timestamp(integer year, integer month, integer day, integer time)
+{
+	return ((cl_uint)year << 20) | ((cl_uint)month << 16) | ((cl_uint)day << 11) | ((cl_uint)(time / 100) << 6) | (cl_uint)(time % 100);
+}
 
-	// Assign an ulong for holding the execution time of kernels and int for kernel calls
-	execution_time = 0;
-	transfer_time = 0;
-	total_execution_time = 0;
-	kernel_launches = 1;
-	reduced = false;
+// Unpack the year of a timestamp
+integer timestamp_year(cl_uint timestamp)
+{
+	return timestamp >> 20;
+}
 
-	// Dsiaply info
-	cout << "***********************************************************************************************************************************************" << endl;
-	cout << "MEAN REDUCTION FLOATS" << endl;
+// Unpack the month of a timestamp
+integer timestamp_month(cl_uint timestamp)
+{
+	return (timestamp >> 16) & 0xF;
+}
 
-	// Kernel intialisation
-	cl::Kernel kernel_redux_sum = cl::Kernel(program, "reduction_sum");
-	kernel_redux_sum.setArg(0, buffer_input);
-	kernel_redux_sum.setArg(1, buffer_output_redux_sum);
-	kernel_redux_sum.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+// Unpack the day of a timestamp
+integer timestamp_day(cl_uint timestamp)
+{
+	return (timestamp >> 11) & 0x1F;
+}
 
-	// Call all kernels in a sequence
-	cl::Event event_redux_sum_profiling;
-	cl::Event event_redux_sum_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_sum, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_sum_profiling);
+// Unpack the time of day of a timestamp as hhmm
+integer timestamp_time(cl_uint timestamp)
+{
+	return ((timestamp >> 6) & 0x1F) * 100 + (timestamp & 0x3F);
+}
 
-	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_sum, CL_TRUE, 0, output_size, &temperature_redux_sum_result[0], NULL, &event_redux_sum_transfer);
+// Round a value up to a multiple
+size_t round_up(size_t value, size_t multiple)
+{
+	return ((value + multiple - 1) / multiple) * multiple;
+}
 
-	// Display the profiling event data for the kernel
-	execution_time = event_redux_sum_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_sum_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_sum_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_sum_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	total_execution_time = execution_time;
-	cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+// Out of order queue for commands linked by events - in order if the device does not support it
+cl::CommandQueue create_graph_queue(cl::Context &context)
+{
+	try
+	{
+		return cl::CommandQueue(context, CL_QUEUE_PROFILING_ENABLE | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE);
+	}
 
-	// While the element at the local size position is not 0 reduce the min
-	while (!reduced)
+	// The event wait lists still order the commands on an in order queue
+	catch (const cl::Error&)
 	{
-		// If the reduction is complete
-		if (temperature_redux_sum_result[1] == 0.0f) break;/*reduced = true;*/
+		return cl::CommandQueue(context, CL_QUEUE_PROFILING_ENABLE);
+	}
+}
 
-		kernel_redux_sum.setArg(0, buffer_output_redux_sum);
-		kernel_redux_sum.setArg(1, buffer_output_redux_sum);
-		kernel_redux_sum.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+// Whether the device supports the extension of a feature - the feature is reported as skipped otherwise
+bool device_supports(bool supported, const char* extension, const char* feature)
+{
+	if (!supported)
+		cout << feature << " SKIPPED - the device does not support " << extension << endl;
+	return supported;
+}
 
-		// Call all kernels in a sequence
-		queue.enqueueNDRangeKernel(kernel_redux_sum, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_sum_profiling);
+// ********************************************************************************POOLS*****************************************************************************
 
-		// Copy the result from device to host
-		queue.enqueueReadBuffer(buffer_output_redux_sum, CL_TRUE, 0, output_size, &temperature_redux_sum_result[0], NULL, &event_redux_sum_transfer);
+// Size class of a buffer - eight classes between powers of two
+// A buffer is at most an eighth larger than requested, so the largest columns do not grow by up to double
+size_t size_class(size_t size)
+{
+	size_t power_of_two = 64;
+	while (power_of_two * 2 <= size) power_of_two *= 2;
+	return round_up(max(size, (size_t)64), power_of_two / 8);
+}
 
-		// Display the profiling event data for the kernel
-		execution_time = event_redux_sum_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_sum_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-		transfer_time = event_redux_sum_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_sum_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-		total_execution_time += execution_time;
-		kernel_launches++;
-		cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+// Device buffer of at least the size - reused from the pool if one of its size class is free
+cl::Buffer acquire_buffer(cl::Context &context, size_t size)
+{
+	// Free buffers of the size class
+	vector<cl::Buffer> &free_buffers = device_buffers.free_buffers[size_class(size)];
+	if (!free_buffers.empty())
+	{
+		cl::Buffer buffer = free_buffers.back();
+		free_buffers.pop_back();
+		device_buffers.reuses++;
+		return buffer;
 	}
 
-	// Calculate means
-	mean_float = temperature_redux_sum_result[0] / number_of_data_entries;
-	cout << "Total reduction kernel luanches: " << kernel_launches << "\t|| Total time for " << kernel_launches << " executions [nano-seconds]: "	<< total_execution_time << endl;
-	cout << "MEAN TEMPERATURE: "																													<< mean_float			<< endl;
-	cout << "***********************************************************************************************************************************************"				<< endl;
-#pragma endregion
+	// Allocate a new buffer of the size class
+	device_buffers.allocations++;
+	device_buffers.allocated_bytes += size_class(size);
+	return cl::Buffer(context, CL_MEM_READ_WRITE, size_class(size));
+}
 
-#pragma region REDUCTION STANDARD DEVIATION FLOATS
-	// Host - output
-	vector<floating_point> temperature_redux_std_dev_result(input_elements);
+// Return a buffer to the pool - commands still queued on it must be ordered before its next use
+void release_buffer(cl::Buffer &buffer)
+{
+	device_buffers.free_buffers[buffer.getInfo<CL_MEM_SIZE>()].push_back(buffer);
+}
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_std_dev(context, CL_MEM_READ_WRITE, output_size);
+// Kernel of the program - created on first use and reused
+cl::Kernel &cached_kernel(cl::Program &program, const string &name)
+{
+	auto kernel = kernel_cache.find(name);
+	if (kernel == kernel_cache.end())
+		kernel = kernel_cache.emplace(name, cl::Kernel(program, name.c_str())).first;
+	return kernel->second;
+}
 
-	// Assign an ulong for holding the execution time of kernels and int for kernel calls
-	execution_time = 0;
-	transfer_time = 0;
-	total_execution_time = 0;
-	kernel_launches = 1;
-	reduced = false;
+// *********************************************************************************CUBE*****************************************************************************
 
-	// Dsiaply info
-	cout << "***********************************************************************************************************************************************" << endl;
-	cout << "STANDARD DEVIATION REDUCTION FLOATS" << endl;
+// Size and modification time of the data file - the cube is rebuilt when either changes
+void source_signature(const char* file, cl_long &size, cl_long &modified)
+{
+	struct stat file_status;
+	size = modified = -1;
+	if (stat(file, &file_status) == 0)
+	{
+		size = (cl_long)file_status.st_size;
+		modified = (cl_long)file_status.st_mtime;
+	}
+}
 
-	// Kernel initialisation
-	cl::Kernel kernel_redux_std_dev = cl::Kernel(program, "reduction_standard_deviation");
-	kernel_redux_std_dev.setArg(0, buffer_input);
-	kernel_redux_std_dev.setArg(1, buffer_output_redux_std_dev);
-	kernel_redux_std_dev.setArg(2, cl::Local(local_size * sizeof(floating_point)));
-	kernel_redux_std_dev.setArg(3, mean_float);
+// Load the aggregate cube - false if there is no cube of the current data file
+// The station names are restored so the query filter resolves to the station codes of the cube
+bool load_aggregate_cube(const string &file, aggregate_cube &cube)
+{
+	// Input file stream
+	ifstream ifs(file, ios::binary);
+	if (!ifs.is_open()) return false;
+
+	// Signature of the data file the cube was built from - a stale cube is not loaded
+	cl_long size = 0, modified = 0;
+	source_signature(::file, size, modified);
+	ifs.read((char*)&cube.source_size, sizeof(cube.source_size));
+	ifs.read((char*)&cube.source_modified, sizeof(cube.source_modified));
+	if (!ifs.good() || cube.source_size != size || cube.source_modified != modified) return false;
+
+	// Station names
+	cl_uint stations = 0;
+	ifs.read((char*)&stations, sizeof(stations));
+	vector<string> names(stations);
+	for (string &name : names)
+	{
+		cl_uint length = 0;
+		ifs.read((char*)&length, sizeof(length));
+		name.resize(length);
+		ifs.read(&name[0], length);
+	}
 
-	// Call all kernels in a sequence
-	cl::Event event_redux_std_dev_profiling;
-	cl::Event event_redux_std_dev_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_std_dev, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_std_dev_profiling);
+	// Years and cells - one cell per station, year and month
+	ifs.read((char*)&cube.first_year, sizeof(cube.first_year));
+	ifs.read((char*)&cube.years, sizeof(cube.years));
+	cube.cells.resize(stations * cube.years * 12);
+	if (!cube.cells.empty()) ifs.read((char*)&cube.cells[0], cube.cells.size() * sizeof(moments));
+	if (!ifs.good()) return false;
 
-	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_std_dev, CL_TRUE, 0, output_size, &temperature_redux_std_dev_result[0], NULL, &event_redux_std_dev_transfer);
+	station_names = names;
+	return true;
+}
 
-	// Display the profiling event data for the kernel
-	execution_time = event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_std_dev_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	total_execution_time = execution_time;
-	cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+// Save the aggregate cube
+void save_aggregate_cube(const string &file, const aggregate_cube &cube)
+{
+	// Output file stream
+	ofstream ofs(file, ios::binary);
+
+	// Signature of the data file
+	ofs.write((const char*)&cube.source_size, sizeof(cube.source_size));
+	ofs.write((const char*)&cube.source_modified, sizeof(cube.source_modified));
 
-	// While the element at the local size position is not 0 reduce the sum
-	while (!reduced)
+	// Station names
+	cl_uint stations = (cl_uint)station_names.size();
+	ofs.write((const char*)&stations, sizeof(stations));
+	for (const string &name : station_names)
 	{
-		// If the reduction is complete
-		if (temperature_redux_std_dev_result[1] == 0.0f) break; /*reduced = true;*/
+		cl_uint length = (cl_uint)name.size();
+		ofs.write((const char*)&length, sizeof(length));
+		ofs.write(name.data(), length);
+	}
 
-		kernel_redux_sum.setArg(0, buffer_output_redux_std_dev);
-		kernel_redux_sum.setArg(1, buffer_output_redux_std_dev);
-		kernel_redux_sum.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+	// Years and cells
+	ofs.write((const char*)&cube.first_year, sizeof(cube.first_year));
+	ofs.write((const char*)&cube.years, sizeof(cube.years));
+	if (!cube.cells.empty()) ofs.write((const char*)&cube.cells[0], cube.cells.size() * sizeof(moments));
+}
 
-		// Call all kernels in a sequence
-		queue.enqueueNDRangeKernel(kernel_redux_sum, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_std_dev_profiling);
+// Reduce the records into the station, year and month cells of a cube on device
+aggregate_cube cube_moments_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size)
+{
+	// Number of records and the padded number of work items
+	aggregate_cube cube;
+	size_t records_count = records.temperature.size();
+	size_t input_elements = round_up(records_count, local_size);
+	if (!records_count) return cube;
+
+	// Range of years of the records
+	integer last_year = INT_MIN;
+	cube.first_year = INT_MAX;
+	for (cl_uint timestamp : records.timestamp)
+	{
+		cube.first_year = min(cube.first_year, timestamp_year(timestamp));
+		last_year = max(last_year, timestamp_year(timestamp));
+	}
+	cube.years = last_year - cube.first_year + 1;
+	size_t cells = station_names.size() * cube.years * 12;
 
-		// Copy the result from device to host
-		queue.enqueueReadBuffer(buffer_output_redux_std_dev, CL_TRUE, 0, output_size, &temperature_redux_std_dev_result[0], NULL, &event_redux_std_dev_transfer);
+	// Size in bytes
+	size_t station_size = records_count * sizeof(cl_uchar);
+	size_t timestamp_size = records_count * sizeof(cl_uint);
+	size_t input_size = records_count * sizeof(fixed_point);
+	size_t cell_size = cells * sizeof(cl_long);
+	size_t cell_size_int = cells * sizeof(integer);
+
+	// Device - pooled column and cell buffers
+	cl::Buffer buffer_station = acquire_buffer(context, station_size);
+	cl::Buffer buffer_timestamp = acquire_buffer(context, timestamp_size);
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+	cl::Buffer buffer_count = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_sum = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_sum_squares = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_min = acquire_buffer(context, cell_size_int);
+	cl::Buffer buffer_max = acquire_buffer(context, cell_size_int);
+
+	// Copy the columns to device memory and fill the cells with the neutral elements
+	vector<cl::Event> events_upload(3);
+	queue.enqueueWriteBuffer(buffer_station, CL_TRUE, 0, station_size, &records.station[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_timestamp, CL_TRUE, 0, timestamp_size, &records.timestamp[0], NULL, &events_upload[1]);
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &records.temperature[0], NULL, &events_upload[2]);
+	queue.enqueueFillBuffer(buffer_count, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_sum, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_sum_squares, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_min, INT_MAX, 0, cell_size_int);
+	queue.enqueueFillBuffer(buffer_max, INT_MIN, 0, cell_size_int);
 
-		// Display the profiling event data for the kernel
-		execution_time = event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-		transfer_time = event_redux_std_dev_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-		total_execution_time += execution_time;
-		kernel_launches++;
-		cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+	// Kernel intialisation
+	cl::Kernel &kernel_cube = cached_kernel(program, "cube_moments");
+	kernel_cube.setArg(0, buffer_station);
+	kernel_cube.setArg(1, buffer_timestamp);
+	kernel_cube.setArg(2, buffer_input);
+	kernel_cube.setArg(3, buffer_count);
+	kernel_cube.setArg(4, buffer_sum);
+	kernel_cube.setArg(5, buffer_sum_squares);
+	kernel_cube.setArg(6, buffer_min);
+	kernel_cube.setArg(7, buffer_max);
+	for (cl_uint i = 8; i < 13; i++)
+		kernel_cube.setArg(i, cl::Local(local_size * sizeof(integer)));
+	kernel_cube.setArg(13, cube.first_year);
+	kernel_cube.setArg(14, cube.years);
+	kernel_cube.setArg(15, (integer)records_count);
+
+	// Call the kernel - a single pass over the records
+	cl::Event event_cube_profiling;
+	queue.enqueueNDRangeKernel(kernel_cube, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_cube_profiling);
+
+	// Copy the result from device to host
+	vector<cl_long> cell_count(cells), cell_sum(cells), cell_sum_squares(cells);
+	vector<integer> cell_min(cells), cell_max(cells);
+	vector<cl::Event> events_read(5);
+	queue.enqueueReadBuffer(buffer_count, CL_TRUE, 0, cell_size, &cell_count[0], NULL, &events_read[0]);
+	queue.enqueueReadBuffer(buffer_sum, CL_TRUE, 0, cell_size, &cell_sum[0], NULL, &events_read[1]);
+	queue.enqueueReadBuffer(buffer_sum_squares, CL_TRUE, 0, cell_size, &cell_sum_squares[0], NULL, &events_read[2]);
+	queue.enqueueReadBuffer(buffer_min, CL_TRUE, 0, cell_size_int, &cell_min[0], NULL, &events_read[3]);
+	queue.enqueueReadBuffer(buffer_max, CL_TRUE, 0, cell_size_int, &cell_max[0], NULL, &events_read[4]);
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_station, &buffer_timestamp, &buffer_input, &buffer_count, &buffer_sum, &buffer_sum_squares, &buffer_min, &buffer_max })
+		release_buffer(*buffer);
+
+	// Display the profiling event data for the kernel
+	cl_ulong execution_time = event_cube_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_cube_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "Total cube kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time << endl;
+
+	// The kernel reads every record, finds its cell and adds its 5 moments - the records are ordered so every cell is merged about once
+	size_t record_size = sizeof(cl_uchar) + sizeof(cl_uint) + sizeof(fixed_point);
+	roofline_report("cube moments", execution_time, (double)records_count * record_size + (double)(3 * cell_size + 2 * cell_size_int), (double)records_count * 10);
+	transfer_report("records upload", profiled_time(events_upload), (double)records_count * record_size, true);
+	transfer_report("read back", profiled_time(events_read), (double)(3 * cell_size + 2 * cell_size_int), false);
+
+	// Convert the fixed point sums to moments - divide by 10 due to the multiplication of the ints
+	cube.cells.resize(cells);
+	for (size_t i = 0; i < cells; i++)
+	{
+		if (!cell_count[i]) continue;
+		moments &cell = cube.cells[i];
+		cell.count = cell_count[i];
+		cell.sum = cell_sum[i] / 10.0;
+		cell.m2 = (cell_sum_squares[i] - (double)cell_sum[i] * cell_sum[i] / cell_count[i]) / 100.0;
+		cell.min = cell_min[i] / 10.0f;
+		cell.max = cell_max[i] / 10.0f;
 	}
 
-	// Calculate means
-	variance_float = temperature_redux_std_dev_result[0] / number_of_data_entries;
-	cout << "Total reduction kernel luanches: " << kernel_launches << "\t|| Total time for " << kernel_launches << " executions [nano-seconds]: "	<< total_execution_time << endl;
-	cout << "VARIANCE: "																															<< variance_float		<< endl;
-	cout << "STANDARD DEVIATION: "																													<< sqrt(variance_float) << endl;
-	cout << "***********************************************************************************************************************************************"				<< endl;
-#pragma endregion
+	return cube;
 }
 
-// *****************************************************************************INTEGERS*****************************************************************************
-
-// Integer kernel calls
-void integer_kernel_calls(size_t input_size, cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, vector<integer> air_temperatures, size_t local_size)
+// Answer the query filter by merging the cells of the cube - the cube is built and saved next to the data file if missing or stale
+void cube_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size)
 {
-	// Device - input buffer
-	cl::Buffer buffer_input(context, CL_MEM_READ_WRITE, input_size);
+	// Cube of the data file - rebuilt from the records if missing or stale
+	string cube_file = string(file) + ".cube";
+	aggregate_cube cube;
+	bool cube_loaded = load_aggregate_cube(cube_file, cube);
+	if (!cube_loaded)
+	{
+		hi_res_time_point start_of_read = hi_res_clock::now();
+		record_columns records = load_file_records(file);
+		auto time_elapsed_read_and_parse = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_read).count() / milli_to_seconds;
+		cout << "RECORDS: " << records.temperature.size() << "\t|| time to read and parse [seconds]: " << time_elapsed_read_and_parse << endl;
+
+		cube = cube_moments_kernel_calls(context, queue, program, records, local_size);
+		source_signature(file, cube.source_size, cube.source_modified);
+		save_aggregate_cube(cube_file, cube);
+	}
 
-	// Copy temperatures arrays to and initialise other arrays on device memory
-	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &air_temperatures[0]);
+	// The cube answers the station, year and month filters - finer filters need the records
+	// The station of the filter - the number of stations selects all of them
+	size_t station_filter = station_names.size();
+	if (!query_filter.station_name.empty())
+	{
+		station_filter = find(station_names.begin(), station_names.end(), query_filter.station_name) - station_names.begin();
+		if (station_filter == station_names.size())
+		{
+			cout << "Unknown station: " << query_filter.station_name << endl;
+			return;
+		}
+	}
 
-	// Reduction kernel calls
-	integer_reduction(context, input_elements, queue, program, buffer_input, local_size);
+	// Merge the selected cells - in total, per station and per year
+	hi_res_time_point start_of_roll_up = hi_res_clock::now();
+	moments total;
+	vector<moments> station_total(station_names.size()), year_total(cube.years);
+	for (size_t station = 0; station < station_names.size(); station++)
+	{
+		if (station_filter != station_names.size() && station != station_filter) continue;
+		for (integer year = 0; year < cube.years; year++)
+		{
+			if (cube.first_year + year < query_filter.year_range.s[0] || cube.first_year + year > query_filter.year_range.s[1]) continue;
+			for (integer month = 1; month <= 12; month++)
+			{
+				if (month < query_filter.month_range.s[0] || month > query_filter.month_range.s[1]) continue;
+				const moments &cell = cube.cells[(station * cube.years + year) * 12 + month - 1];
+				merge_moments(total, cell);
+				merge_moments(station_total[station], cell);
+				merge_moments(year_total[year], cell);
+			}
+		}
+	}
+	auto time_elapsed_roll_up = chrono::duration_cast<chrono::nanoseconds>(hi_res_clock::now() - start_of_roll_up).count();
+
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << (cube_loaded ? "CUBE LOADED: " : "CUBE BUILT: ") << cube_file << "\t|| cells: " << cube.cells.size() << "\t|| years: " << cube.first_year << " - " << cube.first_year + cube.years - 1 << endl;
+	cout << "Roll-up of the cells [nano-seconds]: " << time_elapsed_roll_up << endl;
+	if (query_filter.day_range.s[0] != INT_MIN || query_filter.time_range.s[0] != INT_MIN || query_filter.temperature_range.s[0] != -FLT_MAX)
+		cout << "The day, time and temperature filters are finer than the cells of the cube - ignored" << endl;
+
+	// Display the merged statistics
+	cout << "TOTAL RECORDS: " << total.count << endl;
+	if (total.count)
+	{
+		cout << "MAX TEMPERATURE: " << total.max << endl;
+		cout << "MIN TEMPERATURE: " << total.min << endl;
+		cout << "MEAN TEMPERATURE: " << total.sum / total.count << endl;
+		cout << "VARIANCE: " << total.m2 / total.count << endl;
+		cout << "STANDARD DEVIATION: " << sqrt(total.m2 / total.count) << endl;
+	}
+
+	// Display the statistics of each station and year
+	for (size_t station = 0; station < station_names.size(); station++)
+		if (station_total[station].count)
+			cout << station_names[station] << "\t|| records: " << station_total[station].count << "\t|| mean: " << station_total[station].sum / station_total[station].count
+				<< "\t|| standard deviation: " << sqrt(station_total[station].m2 / station_total[station].count) << "\t|| min: " << station_total[station].min << "\t|| max: " << station_total[station].max << endl;
+	for (integer year = 0; year < cube.years; year++)
+		if (year_total[year].count)
+			cout << cube.first_year + year << "\t|| records: " << year_total[year].count << "\t|| mean: " << year_total[year].sum / year_total[year].count
+				<< "\t|| standard deviation: " << sqrt(year_total[year].m2 / year_total[year].count) << "\t|| min: " << year_total[year].min << "\t|| max: " << year_total[year].max << endl;
+	cout << "***********************************************************************************************************************************************" << endl;
 }
 
-// Reduction integer value
-void integer_reduction(cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t local_size)
+// ******************************************************************************COMPRESSION*************************************************************************
+
+// Compress the fixed point temperatures in blocks - frame of reference plus bit packed offsets
+compressed_column compress_temperatures(const vector<fixed_point> &temperatures, size_t block_size)
 {
-#pragma region REDUCTION MAX INTS
-	// Host - output
-	vector<integer> temperature_redux_max_result(input_elements);
+	compressed_column column;
+	column.count = (cl_uint)temperatures.size();
+	column.block_size = (cl_uint)block_size;
 
-	// Size in bytes
-	size_t output_size = temperature_redux_max_result.size() * sizeof(integer);
+	for (size_t first = 0; first < temperatures.size(); first += block_size)
+	{
+		size_t last = min(first + block_size, temperatures.size());
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_max(context, CL_MEM_READ_WRITE, output_size);
+		// Frame of reference - the minimum of the block
+		fixed_point reference = *min_element(temperatures.begin() + first, temperatures.begin() + last);
+		fixed_point maximum = *max_element(temperatures.begin() + first, temperatures.begin() + last);
 
-	// Zero output buffers on device memory
-	queue.enqueueFillBuffer(buffer_output_redux_max, 0, 0, output_size);
+		// Bits needed for the largest offset from the reference
+		cl_uint range = (cl_uint)(maximum - reference);
+		cl_uchar width = 0;
+		while (range >> width) width++;
 
-	// Assign an ulong for holding the execution time of kernels
-	cl_ulong transfer_time;
-	cl_ulong execution_time;
+		column.reference.push_back(reference);
+		column.bit_width.push_back(width);
+		column.block_offset.push_back((cl_uint)column.words.size());
 
-	// Display info
-	cout << "***********************************************************************************************************************************************" << endl;
-	cout << "MAX REDUCTION INTEGERS - ATOMIC METHOD" << endl;
+		// Every temperature of the block is the reference
+		if (!width) continue;
 
-	// Kernel intialisation
-	cl::Kernel kernel_redux_max = cl::Kernel(program, "reduction_max_int");
-	kernel_redux_max.setArg(0, buffer_input);
-	kernel_redux_max.setArg(1, buffer_output_redux_max);
-	kernel_redux_max.setArg(2, cl::Local(local_size * sizeof(integer)));
+		// Pack the offsets - every block starts on a new word so the blocks decompress independently
+		size_t word = column.words.size();
+		column.words.resize(word + (block_size * width + 31) / 32, 0);
+		for (size_t i = first; i < last; i++)
+		{
+			cl_uint delta = (cl_uint)(temperatures[i] - reference);
+			size_t bit = (i - first) * width;
+			column.words[word + bit / 32] |= delta << (bit % 32);
+			if (bit % 32 + width > 32)
+				column.words[word + bit / 32 + 1] |= delta >> (32 - bit % 32);
+		}
+	}
+
+	// Device buffers can not be empty
+	if (column.words.empty()) column.words.push_back(0);
+
+	return column;
+}
+
+// Load the compressed column - false if there is no cache of the current data file
+bool load_compressed_column(const string &file, compressed_column &column)
+{
+	// Input file stream
+	ifstream ifs(file, ios::binary);
+	if (!ifs.is_open()) return false;
+
+	// Signature of the data file the column was compressed from - a stale cache is not loaded
+	cl_long size = 0, modified = 0;
+	source_signature(::file, size, modified);
+	ifs.read((char*)&column.source_size, sizeof(column.source_size));
+	ifs.read((char*)&column.source_modified, sizeof(column.source_modified));
+	if (!ifs.good() || column.source_size != size || column.source_modified != modified) return false;
+
+	// Number of temperatures, block size and number of words
+	cl_uint words = 0;
+	ifs.read((char*)&column.count, sizeof(column.count));
+	ifs.read((char*)&column.block_size, sizeof(column.block_size));
+	ifs.read((char*)&words, sizeof(words));
+	if (!ifs.good() || !column.block_size || !words) return false;
+
+	// Reference, bit width and first word of each block and the packed words
+	size_t blocks = round_up(column.count, column.block_size) / column.block_size;
+	column.reference.resize(blocks);
+	column.bit_width.resize(blocks);
+	column.block_offset.resize(blocks);
+	column.words.resize(words);
+	if (blocks)
+	{
+		ifs.read((char*)&column.reference[0], blocks * sizeof(fixed_point));
+		ifs.read((char*)&column.bit_width[0], blocks * sizeof(cl_uchar));
+		ifs.read((char*)&column.block_offset[0], blocks * sizeof(cl_uint));
+	}
+	ifs.read((char*)&column.words[0], words * sizeof(cl_uint));
+
+	return ifs.good();
+}
+
+// Save the compressed column
+void save_compressed_column(const string &file, const compressed_column &column)
+{
+	// Output file stream
+	ofstream ofs(file, ios::binary);
+
+	// Signature of the data file
+	ofs.write((const char*)&column.source_size, sizeof(column.source_size));
+	ofs.write((const char*)&column.source_modified, sizeof(column.source_modified));
+
+	// Number of temperatures, block size and number of words
+	cl_uint words = (cl_uint)column.words.size();
+	ofs.write((const char*)&column.count, sizeof(column.count));
+	ofs.write((const char*)&column.block_size, sizeof(column.block_size));
+	ofs.write((const char*)&words, sizeof(words));
+
+	// Reference, bit width and first word of each block and the packed words
+	size_t blocks = column.reference.size();
+	if (blocks)
+	{
+		ofs.write((const char*)&column.reference[0], blocks * sizeof(fixed_point));
+		ofs.write((const char*)&column.bit_width[0], blocks * sizeof(cl_uchar));
+		ofs.write((const char*)&column.block_offset[0], blocks * sizeof(cl_uint));
+	}
+	ofs.write((const char*)&column.words[0], words * sizeof(cl_uint));
+}
+
+// Reduce the compressed temperatures - decompressed on device
+void compressed_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size)
+{
+	// Compressed temperatures from the cache - compressed from the file and cached if there is none or the file has changed
+	hi_res_time_point start_of_read = hi_res_clock::now();
+	compressed_column column;
+	bool cache_loaded = load_compressed_column(compressed_cache_file, column) && column.block_size == local_size;
+	if (!cache_loaded)
+	{
+		column = compress_temperatures(load_file_int(file), local_size);
+		source_signature(file, column.source_size, column.source_modified);
+		save_compressed_column(compressed_cache_file, column);
+	}
+	auto time_elapsed_read = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_read).count() / milli_to_seconds;
+
+	// Number of temperatures, blocks and work items - one work group per block
+	number_of_data_entries = column.count;
+	size_t blocks = column.reference.size();
+	size_t input_elements = blocks * local_size;
+
+	// Size in bytes
+	size_t reference_size = blocks * sizeof(fixed_point);
+	size_t bit_width_size = blocks * sizeof(cl_uchar);
+	size_t block_offset_size = blocks * sizeof(cl_uint);
+	size_t words_size = column.words.size() * sizeof(cl_uint);
+	size_t compressed_size = reference_size + bit_width_size + block_offset_size + words_size;
+	size_t uncompressed_size = column.count * sizeof(fixed_point);
+	size_t output_size = 3 * sizeof(integer);
+
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << (cache_loaded ? "COMPRESSED CACHE: " : "COMPRESSED AND CACHED: ") << compressed_cache_file << "\t|| time to read [seconds]: " << time_elapsed_read << endl;
+	cout << "Temperatures: " << column.count << "\t|| blocks: " << blocks << "\t|| uncompressed [bytes]: " << uncompressed_size << "\t|| compressed [bytes]: " << compressed_size
+		<< "\t|| ratio: " << (float)uncompressed_size / compressed_size << endl;
+
+	// Nothing to reduce
+	if (!blocks)
+	{
+		cout << "No records to reduce" << endl;
+		return;
+	}
+
+	// Device - pooled input buffers
+	cl::Buffer buffer_reference = acquire_buffer(context, reference_size);
+	cl::Buffer buffer_bit_width = acquire_buffer(context, bit_width_size);
+	cl::Buffer buffer_block_offset = acquire_buffer(context, block_offset_size);
+	cl::Buffer buffer_words = acquire_buffer(context, words_size);
+
+	// Device - pooled output buffers
+	cl::Buffer buffer_output = acquire_buffer(context, output_size);
+	cl::Buffer buffer_output_std_dev = acquire_buffer(context, sizeof(integer));
+
+	// Copy the compressed column to device memory - the transfer time gives the bandwidth of the compressed bytes and the effective bandwidth of the temperatures they hold
+	vector<cl::Event> events_transfer(4);
+	queue.enqueueWriteBuffer(buffer_reference, CL_TRUE, 0, reference_size, &column.reference[0], NULL, &events_transfer[0]);
+	queue.enqueueWriteBuffer(buffer_bit_width, CL_TRUE, 0, bit_width_size, &column.bit_width[0], NULL, &events_transfer[1]);
+	queue.enqueueWriteBuffer(buffer_block_offset, CL_TRUE, 0, block_offset_size, &column.block_offset[0], NULL, &events_transfer[2]);
+	queue.enqueueWriteBuffer(buffer_words, CL_TRUE, 0, words_size, &column.words[0], NULL, &events_transfer[3]);
+	cl_ulong transfer_time = profiled_time(events_transfer);
+
+	// Fill the outputs with the neutral elements of the reductions
+	vector<integer> neutral = { INT_MIN, INT_MAX, 0 };
+	cl::Event event_neutral_transfer;
+	queue.enqueueWriteBuffer(buffer_output, CL_TRUE, 0, output_size, &neutral[0], NULL, &event_neutral_transfer);
+	queue.enqueueFillBuffer(buffer_output_std_dev, 0, 0, sizeof(integer));
+
+	// Kernel intialisation from the cache
+	cl::Kernel &kernel_redux = cached_kernel(program, "reduction_compressed_int");
+	kernel_redux.setArg(0, buffer_reference);
+	kernel_redux.setArg(1, buffer_bit_width);
+	kernel_redux.setArg(2, buffer_block_offset);
+	kernel_redux.setArg(3, buffer_words);
+	kernel_redux.setArg(4, buffer_output);
+	kernel_redux.setArg(5, cl::Local(local_size * sizeof(integer)));
+	kernel_redux.setArg(6, cl::Local(local_size * sizeof(integer)));
+	kernel_redux.setArg(7, cl::Local(local_size * sizeof(integer)));
+	kernel_redux.setArg(8, (integer)column.count);
+
+	// Call the kernel - max, min and sum in a single pass
+	cl::Event event_redux_profiling;
+	queue.enqueueNDRangeKernel(kernel_redux, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_profiling);
+
+	// Kernel intialisation from the cache
+	cl::Kernel &kernel_redux_std_dev = cached_kernel(program, "reduction_compressed_standard_deviation_int");
+	kernel_redux_std_dev.setArg(0, buffer_reference);
+	kernel_redux_std_dev.setArg(1, buffer_bit_width);
+	kernel_redux_std_dev.setArg(2, buffer_block_offset);
+	kernel_redux_std_dev.setArg(3, buffer_words);
+	kernel_redux_std_dev.setArg(4, buffer_output_std_dev);
+	kernel_redux_std_dev.setArg(5, cl::Local(local_size * sizeof(integer)));
+	kernel_redux_std_dev.setArg(6, buffer_output);
+	kernel_redux_std_dev.setArg(7, (integer)column.count);
+
+	// Call the kernel
+	cl::Event event_redux_std_dev_profiling;
+	queue.enqueueNDRangeKernel(kernel_redux_std_dev, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_std_dev_profiling);
+
+	// Copy the results from device to host
+	vector<integer> result(3);
+	integer result_std_dev = 0;
+	vector<cl::Event> events_read(2);
+	queue.enqueueReadBuffer(buffer_output, CL_TRUE, 0, output_size, &result[0], NULL, &events_read[0]);
+	queue.enqueueReadBuffer(buffer_output_std_dev, CL_TRUE, 0, sizeof(integer), &result_std_dev, NULL, &events_read[1]);
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_reference, &buffer_bit_width, &buffer_block_offset, &buffer_words, &buffer_output, &buffer_output_std_dev })
+		release_buffer(*buffer);
+
+	// Calculate means and variance
+	mean_float = (result[2] / 10.0f) / number_of_data_entries;
+	mean_int = (int)(mean_float * 10.0f);
+	variance_float = (result_std_dev / 10.0f) / number_of_data_entries;
+
+	// Display the profiling event data for the kernels
+	cl_ulong execution_time = event_redux_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>()
+		+ event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "Total reduction kernel luanches: 2 \t|| Total time for all executions [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+	cout << "Upload of the compressed bytes [GB/s]: " << (double)compressed_size / transfer_time << "\t|| effective upload of the uncompressed temperatures [GB/s]: " << (double)uncompressed_size / transfer_time << endl;
+	cout << "MAX TEMPERATURE: " << result[0] / 10.0f << endl;
+	cout << "MIN TEMPERATURE: " << result[1] / 10.0f << endl;
+	cout << "MEAN TEMPERATURE: " << mean_float << endl;
+	cout << "VARIANCE: " << variance_float << endl;
+	cout << "STANDARD DEVIATION: " << sqrt(variance_float) << endl;
+
+	// Each kernel reads the compressed column and merges per work group - decompressing a temperature shifts, masks and adds
+	// The single pass combines three reductions, the standard deviation subtracts, squares, divides and adds
+	roofline_report("compressed max, min and sum", event_redux_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>(),
+		(double)compressed_size + (double)blocks * output_size, (double)input_elements * (4 + 3));
+	roofline_report("compressed standard deviation", event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>(),
+		(double)compressed_size + (double)blocks * sizeof(integer), (double)input_elements * (4 + 4));
+	transfer_report("compressed upload", transfer_time, (double)compressed_size, true);
+	transfer_report("neutral elements upload", event_neutral_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_neutral_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>(), (double)output_size, true);
+	transfer_report("read back", profiled_time(events_read), (double)(output_size + sizeof(integer)), false);
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// ******************************************************************************DATASETS****************************************************************************
+
+// Reduce every input file in a single segmented launch - one row of the results table per file
+void batch_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size)
+{
+	// Concatenate the datasets - each padded to whole work groups and its groups mapped to it
+	hi_res_time_point start_of_read = hi_res_clock::now();
+	vector<fixed_point> temperatures;
+	vector<integer> group_dataset, dataset_offset, dataset_count;
+	for (size_t dataset = 0; dataset < batch_files.size(); dataset++)
+	{
+		vector<fixed_point> dataset_temperatures = load_file_int(batch_files[dataset].c_str());
+		dataset_offset.push_back((integer)temperatures.size());
+		dataset_count.push_back((integer)dataset_temperatures.size());
+		temperatures.insert(temperatures.end(), dataset_temperatures.begin(), dataset_temperatures.end());
+		temperatures.resize(round_up(temperatures.size(), local_size), 0);
+		group_dataset.resize(temperatures.size() / local_size, (integer)dataset);
+	}
+	auto time_elapsed_read_and_parse = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_read).count() / milli_to_seconds;
+
+	// Number of datasets and work items
+	size_t datasets = batch_files.size();
+	size_t input_elements = temperatures.size();
+
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "DATASETS: " << datasets << "\t|| records: " << accumulate(dataset_count.begin(), dataset_count.end(), (cl_long)0) << "\t|| time to read and parse [seconds]: " << time_elapsed_read_and_parse << endl;
+
+	// Nothing to reduce
+	if (!input_elements)
+	{
+		cout << "No records to reduce" << endl;
+		return;
+	}
+
+	// Size in bytes
+	size_t input_size = input_elements * sizeof(fixed_point);
+	size_t group_size = group_dataset.size() * sizeof(integer);
+	size_t dataset_size = datasets * sizeof(integer);
+	size_t dataset_size_long = datasets * sizeof(cl_long);
+
+	// Device - pooled input and output buffers
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+	cl::Buffer buffer_group_dataset = acquire_buffer(context, group_size);
+	cl::Buffer buffer_dataset_offset = acquire_buffer(context, dataset_size);
+	cl::Buffer buffer_dataset_count = acquire_buffer(context, dataset_size);
+	cl::Buffer buffer_sum = acquire_buffer(context, dataset_size_long);
+	cl::Buffer buffer_sum_squares = acquire_buffer(context, dataset_size_long);
+	cl::Buffer buffer_min = acquire_buffer(context, dataset_size);
+	cl::Buffer buffer_max = acquire_buffer(context, dataset_size);
+
+	// Copy the datasets to device memory and fill the outputs with the neutral elements
+	cl::Event event_input_transfer;
+	vector<cl::Event> events_table_transfer(3);
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &temperatures[0], NULL, &event_input_transfer);
+	queue.enqueueWriteBuffer(buffer_group_dataset, CL_TRUE, 0, group_size, &group_dataset[0], NULL, &events_table_transfer[0]);
+	queue.enqueueWriteBuffer(buffer_dataset_offset, CL_TRUE, 0, dataset_size, &dataset_offset[0], NULL, &events_table_transfer[1]);
+	queue.enqueueWriteBuffer(buffer_dataset_count, CL_TRUE, 0, dataset_size, &dataset_count[0], NULL, &events_table_transfer[2]);
+	queue.enqueueFillBuffer(buffer_sum, (cl_long)0, 0, dataset_size_long);
+	queue.enqueueFillBuffer(buffer_sum_squares, (cl_long)0, 0, dataset_size_long);
+	queue.enqueueFillBuffer(buffer_min, INT_MAX, 0, dataset_size);
+	queue.enqueueFillBuffer(buffer_max, INT_MIN, 0, dataset_size);
+
+	// Kernel intialisation
+	cl::Kernel &kernel_segmented = cached_kernel(program, "segmented_moments");
+	kernel_segmented.setArg(0, buffer_input);
+	kernel_segmented.setArg(1, buffer_group_dataset);
+	kernel_segmented.setArg(2, buffer_dataset_offset);
+	kernel_segmented.setArg(3, buffer_dataset_count);
+	kernel_segmented.setArg(4, buffer_sum);
+	kernel_segmented.setArg(5, buffer_sum_squares);
+	kernel_segmented.setArg(6, buffer_min);
+	kernel_segmented.setArg(7, buffer_max);
+	kernel_segmented.setArg(8, cl::Local(local_size * sizeof(integer)));
+	kernel_segmented.setArg(9, cl::Local(local_size * sizeof(integer)));
+	kernel_segmented.setArg(10, cl::Local(local_size * sizeof(integer)));
+	kernel_segmented.setArg(11, cl::Local(local_size * sizeof(integer)));
+
+	// Call the kernel - a single launch over all datasets
+	cl::Event event_segmented_profiling;
+	queue.enqueueNDRangeKernel(kernel_segmented, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_segmented_profiling);
+
+	// Copy the results from device to host
+	vector<cl_long> sum(datasets), sum_squares(datasets);
+	vector<integer> minimum(datasets), maximum(datasets);
+	vector<cl::Event> events_read(4);
+	queue.enqueueReadBuffer(buffer_sum, CL_TRUE, 0, dataset_size_long, &sum[0], NULL, &events_read[0]);
+	queue.enqueueReadBuffer(buffer_sum_squares, CL_TRUE, 0, dataset_size_long, &sum_squares[0], NULL, &events_read[1]);
+	queue.enqueueReadBuffer(buffer_min, CL_TRUE, 0, dataset_size, &minimum[0], NULL, &events_read[2]);
+	queue.enqueueReadBuffer(buffer_max, CL_TRUE, 0, dataset_size, &maximum[0], NULL, &events_read[3]);
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_input, &buffer_group_dataset, &buffer_dataset_offset, &buffer_dataset_count, &buffer_sum, &buffer_sum_squares, &buffer_min, &buffer_max })
+		release_buffer(*buffer);
+
+	// Display the profiling event data for the kernel
+	cl_ulong execution_time = event_segmented_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_segmented_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cl_ulong transfer_time = event_input_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_input_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+
+	// The kernel reads every short and the dataset of its work group and merges four moments per work group - sum, square, min and max of each element
+	size_t work_groups = input_elements / local_size;
+	roofline_report("segmented moments", execution_time, (double)input_size + (double)work_groups * (3 * sizeof(integer) + 2 * sizeof(cl_long) + 2 * sizeof(integer)),
+		(double)input_elements * 5);
+	transfer_report("input upload", transfer_time, (double)input_size, true);
+	transfer_report("dataset tables upload", profiled_time(events_table_transfer), (double)(group_size + 2 * dataset_size), true);
+	transfer_report("read back", profiled_time(events_read), (double)(2 * dataset_size_long + 2 * dataset_size), false);
+	cout << "***********************************************************************************************************************************************" << endl;
+
+	// Display the results table - temperatures are in fixed point tenths
+	cout << "DATASET\t\t\t\t|| RECORDS\t|| MIN\t|| MAX\t|| MEAN\t\t|| STANDARD DEVIATION" << endl;
+	for (size_t dataset = 0; dataset < datasets; dataset++)
+	{
+		cout << batch_files[dataset] << "\t\t|| " << dataset_count[dataset];
+		if (dataset_count[dataset])
+		{
+			double mean = (double)sum[dataset] / dataset_count[dataset];
+			double variance = max((double)sum_squares[dataset] / dataset_count[dataset] - mean * mean, 0.0);
+			cout << "\t|| " << minimum[dataset] / 10.0f << "\t|| " << maximum[dataset] / 10.0f << "\t|| " << mean / 10.0 << "\t|| " << sqrt(variance) / 10.0;
+		}
+		cout << endl;
+	}
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// ******************************************************************************EXTREMES****************************************************************************
+
+// Station, date and time of a record
+string describe_record(const record_columns &records, size_t index)
+{
+	stringstream sstream;
+	sstream << station_names[records.station[index]] << " " << timestamp_year(records.timestamp[index]) << "-" << setfill('0') << setw(2) << timestamp_month(records.timestamp[index])
+		<< "-" << setw(2) << timestamp_day(records.timestamp[index]) << " " << setw(4) << timestamp_time(records.timestamp[index]);
+	return sstream.str();
+}
+
+// Records of the extreme temperatures - arg max and arg min from packed keys and the k hottest and coldest records
+void extremes_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t k, size_t local_size)
+{
+	// Number of records, work items and groups - at most a work group of candidates per group
+	size_t records_count = records.temperature.size();
+	size_t input_elements = round_up(records_count, local_size);
+	size_t groups = input_elements / local_size;
+	k = min(k, local_size);
+
+	// Nothing to report
+	if (!records_count)
+	{
+		cout << "No records to report" << endl;
+		return;
+	}
+
+	// Size in bytes
+	size_t input_size = records_count * sizeof(fixed_point);
+	size_t output_size = 2 * sizeof(cl_long);
+	size_t candidates_size = groups * k * sizeof(cl_long);
+
+	// Device - pooled input and output buffers
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+	cl::Buffer buffer_output = acquire_buffer(context, output_size);
+	cl::Buffer buffer_coldest = acquire_buffer(context, candidates_size);
+	cl::Buffer buffer_hottest = acquire_buffer(context, candidates_size);
+
+	// Copy the temperatures to device memory and fill the output with the neutral elements
+	vector<cl_long> neutral = { LLONG_MIN, LLONG_MAX };
+	vector<cl::Event> events_upload(2);
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &records.temperature[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_output, CL_TRUE, 0, output_size, &neutral[0], NULL, &events_upload[1]);
+
+	// Kernel intialisation
+	cl::Kernel &kernel_arg_extremes = cached_kernel(program, "reduction_arg_extremes");
+	kernel_arg_extremes.setArg(0, buffer_input);
+	kernel_arg_extremes.setArg(1, buffer_output);
+	kernel_arg_extremes.setArg(2, cl::Local(local_size * sizeof(cl_long)));
+	kernel_arg_extremes.setArg(3, cl::Local(local_size * sizeof(cl_long)));
+	kernel_arg_extremes.setArg(4, (integer)records_count);
+
+	cl::Kernel &kernel_top_k = cached_kernel(program, "top_k_records");
+	kernel_top_k.setArg(0, buffer_input);
+	kernel_top_k.setArg(1, buffer_coldest);
+	kernel_top_k.setArg(2, buffer_hottest);
+	kernel_top_k.setArg(3, cl::Local(local_size * sizeof(cl_long)));
+	kernel_top_k.setArg(4, (integer)k);
+	kernel_top_k.setArg(5, (integer)records_count);
+
+	// Call all kernels in a sequence
+	cl::Event event_arg_extremes_profiling;
+	cl::Event event_top_k_profiling;
+	queue.enqueueNDRangeKernel(kernel_arg_extremes, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_arg_extremes_profiling);
+	queue.enqueueNDRangeKernel(kernel_top_k, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_top_k_profiling);
+
+	// Copy the results from device to host
+	vector<cl_long> extremes(2);
+	vector<cl_long> coldest(groups * k), hottest(groups * k);
+	vector<cl::Event> events_read(3);
+	queue.enqueueReadBuffer(buffer_output, CL_TRUE, 0, output_size, &extremes[0], NULL, &events_read[0]);
+	queue.enqueueReadBuffer(buffer_coldest, CL_TRUE, 0, candidates_size, &coldest[0], NULL, &events_read[1]);
+	queue.enqueueReadBuffer(buffer_hottest, CL_TRUE, 0, candidates_size, &hottest[0], NULL, &events_read[2]);
+
+	// Return the buffers to the pool
+	release_buffer(buffer_input);
+	release_buffer(buffer_output);
+	release_buffer(buffer_coldest);
+	release_buffer(buffer_hottest);
+
+	// Merge the candidates of the groups - unused candidates are dropped
+	coldest.erase(remove(coldest.begin(), coldest.end(), LLONG_MAX), coldest.end());
+	hottest.erase(remove(hottest.begin(), hottest.end(), LLONG_MIN), hottest.end());
+	size_t k_coldest = min(k, coldest.size());
+	size_t k_hottest = min(k, hottest.size());
+	partial_sort(coldest.begin(), coldest.begin() + k_coldest, coldest.end());
+	partial_sort(hottest.begin(), hottest.begin() + k_hottest, hottest.end(), greater<cl_long>());
+
+	// Display the profiling event data for the kernels
+	cl_ulong execution_time_arg_extremes = event_arg_extremes_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_arg_extremes_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cl_ulong execution_time_top_k = event_top_k_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_top_k_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "ARG MAX / ARG MIN REDUCTION - ATOMIC METHOD" << endl;
+	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time_arg_extremes << endl;
+
+	// The kernel reads every short, packs its key and keeps the larger and smaller - two keys merged per work group
+	roofline_report("arg extremes", execution_time_arg_extremes, (double)input_size + (double)groups * output_size, (double)input_elements * 3);
+	transfer_report("input upload", profiled_time(events_upload), (double)(input_size + output_size), true);
+
+	// The record index is the low half of the key and the temperature the high half
+	cout << "MAX TEMPERATURE: " << (integer)(extremes[0] >> 32) / 10.0f << "\t|| " << describe_record(records, (cl_uint)extremes[0]) << endl;
+	cout << "MIN TEMPERATURE: " << (integer)(extremes[1] >> 32) / 10.0f << "\t|| " << describe_record(records, (cl_uint)extremes[1]) << endl;
+	cout << "***********************************************************************************************************************************************" << endl;
+
+	// Display the k hottest and coldest records
+	cout << "TOP " << k << " HOTTEST / COLDEST RECORDS" << endl;
+	cout << "Total kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time_top_k << endl;
+	for (size_t i = 0; i < max(k_hottest, k_coldest); i++)
+	{
+		cout << i + 1;
+		if (i < k_hottest) cout << "\t|| " << (integer)(hottest[i] >> 32) / 10.0f << "\t" << describe_record(records, (cl_uint)hottest[i]);
+		if (i < k_coldest) cout << "\t|| " << (integer)(coldest[i] >> 32) / 10.0f << "\t" << describe_record(records, (cl_uint)coldest[i]);
+		cout << endl;
+	}
+
+	// The kernel reads every short and writes the candidates of each group - the bitonic sort has log(n)(log(n) + 1) / 2 stages of a compare per pair of work items
+	double sort_stages = log2((double)local_size) * (log2((double)local_size) + 1.0) / 2.0;
+	roofline_report("top k", execution_time_top_k, (double)input_size + 2.0 * candidates_size, (double)input_elements * (1.0 + sort_stages / 2.0));
+	transfer_report("read back", profiled_time(events_read), (double)(output_size + 2 * candidates_size), false);
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// ******************************************************************************ANOMALIES***************************************************************************
+
+// Readings unusual for their station and time of year - written to a csv file
+void anomaly_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, floating_point threshold, size_t local_size)
+{
+	// Number of records, cells and the padded number of work items
+	size_t records_count = records.temperature.size();
+	size_t cells = station_names.size() * 366;
+	size_t input_elements = round_up(records_count, local_size);
+
+	// Nothing to score
+	if (!records_count)
+	{
+		cout << "No records to score" << endl;
+		return;
+	}
+
+	// Size in bytes
+	size_t station_size = records_count * sizeof(cl_uchar);
+	size_t timestamp_size = records_count * sizeof(cl_uint);
+	size_t input_size = records_count * sizeof(fixed_point);
+	size_t cell_size = cells * sizeof(cl_long);
+	size_t cell_size_int = cells * sizeof(integer);
+	size_t cell_size_float = cells * sizeof(floating_point);
+
+	// Device - pooled column, climatology and output buffers - the columns stay resident for both stages
+	cl::Buffer buffer_station = acquire_buffer(context, station_size);
+	cl::Buffer buffer_timestamp = acquire_buffer(context, timestamp_size);
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+	cl::Buffer buffer_count = acquire_buffer(context, cell_size_int);
+	cl::Buffer buffer_sum = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_sum_squares = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_baseline_mean = acquire_buffer(context, cell_size_float);
+	cl::Buffer buffer_baseline_std_dev = acquire_buffer(context, cell_size_float);
+	cl::Buffer buffer_anomaly_index = acquire_buffer(context, records_count * sizeof(integer));
+	cl::Buffer buffer_anomaly_score = acquire_buffer(context, records_count * sizeof(floating_point));
+	cl::Buffer buffer_anomaly_count = acquire_buffer(context, sizeof(integer));
+
+	// Copy the columns to device memory and zero the cells and the anomaly count
+	vector<cl::Event> events_upload(3);
+	queue.enqueueWriteBuffer(buffer_station, CL_TRUE, 0, station_size, &records.station[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_timestamp, CL_TRUE, 0, timestamp_size, &records.timestamp[0], NULL, &events_upload[1]);
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &records.temperature[0], NULL, &events_upload[2]);
+	queue.enqueueFillBuffer(buffer_count, 0, 0, cell_size_int);
+	queue.enqueueFillBuffer(buffer_sum, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_sum_squares, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_anomaly_count, 0, 0, sizeof(integer));
+
+	// Kernel intialisation
+	cl::Kernel &kernel_moments = cached_kernel(program, "day_of_year_moments");
+	kernel_moments.setArg(0, buffer_station);
+	kernel_moments.setArg(1, buffer_timestamp);
+	kernel_moments.setArg(2, buffer_input);
+	kernel_moments.setArg(3, buffer_count);
+	kernel_moments.setArg(4, buffer_sum);
+	kernel_moments.setArg(5, buffer_sum_squares);
+	kernel_moments.setArg(6, (integer)records_count);
+
+	cl::Kernel &kernel_baseline = cached_kernel(program, "day_of_year_baseline");
+	kernel_baseline.setArg(0, buffer_count);
+	kernel_baseline.setArg(1, buffer_sum);
+	kernel_baseline.setArg(2, buffer_sum_squares);
+	kernel_baseline.setArg(3, buffer_baseline_mean);
+	kernel_baseline.setArg(4, buffer_baseline_std_dev);
+	kernel_baseline.setArg(5, baseline_half_window);
+	kernel_baseline.setArg(6, (integer)cells);
+
+	cl::Kernel &kernel_score = cached_kernel(program, "score_anomalies");
+	kernel_score.setArg(0, buffer_station);
+	kernel_score.setArg(1, buffer_timestamp);
+	kernel_score.setArg(2, buffer_input);
+	kernel_score.setArg(3, buffer_baseline_mean);
+	kernel_score.setArg(4, buffer_baseline_std_dev);
+	kernel_score.setArg(5, buffer_anomaly_index);
+	kernel_score.setArg(6, buffer_anomaly_score);
+	kernel_score.setArg(7, buffer_anomaly_count);
+	kernel_score.setArg(8, cl::Local(local_size * sizeof(integer)));
+	kernel_score.setArg(9, threshold);
+	kernel_score.setArg(10, (integer)records_count);
+
+	// Call all kernels in a sequence - climatology of the records, baseline of the cells, then the scores
+	vector<cl::Event> events_profiling(3);
+	queue.enqueueNDRangeKernel(kernel_moments, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &events_profiling[0]);
+	queue.enqueueNDRangeKernel(kernel_baseline, cl::NullRange, cl::NDRange(round_up(cells, local_size)), cl::NDRange(local_size), NULL, &events_profiling[1]);
+	queue.enqueueNDRangeKernel(kernel_score, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &events_profiling[2]);
+
+	// Copy the compacted anomalies from device to host
+	integer anomaly_count = 0;
+	vector<cl::Event> events_read(1);
+	queue.enqueueReadBuffer(buffer_anomaly_count, CL_TRUE, 0, sizeof(integer), &anomaly_count, NULL, &events_read[0]);
+	vector<integer> anomaly_index(anomaly_count);
+	vector<floating_point> anomaly_score(anomaly_count);
+	if (anomaly_count)
+	{
+		events_read.resize(3);
+		queue.enqueueReadBuffer(buffer_anomaly_index, CL_TRUE, 0, anomaly_count * sizeof(integer), &anomaly_index[0], NULL, &events_read[1]);
+		queue.enqueueReadBuffer(buffer_anomaly_score, CL_TRUE, 0, anomaly_count * sizeof(floating_point), &anomaly_score[0], NULL, &events_read[2]);
+	}
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_station, &buffer_timestamp, &buffer_input, &buffer_count, &buffer_sum, &buffer_sum_squares,
+		&buffer_baseline_mean, &buffer_baseline_std_dev, &buffer_anomaly_index, &buffer_anomaly_score, &buffer_anomaly_count })
+		release_buffer(*buffer);
+
+	// Display the profiling event data for the kernels
+	cl_ulong execution_time = 0;
+	for (cl::Event &event : events_profiling)
+		execution_time += event.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "ANOMALIES AGAINST THE STATION AND DAY OF THE YEAR BASELINE" << endl;
+	cout << "Total kernel luanches: 3 \t|| Total time for all executions [nano-seconds]: " << execution_time << endl;
+	cout << "ANOMALIES: " << anomaly_count << " OF " << records_count << "\t|| threshold [z-score]: " << threshold << endl;
+
+	// The climatology reads every record and adds to its cell, the baseline pools the cells of the window, the scores read every record and its baseline
+	size_t record_size = sizeof(cl_uchar) + sizeof(cl_uint) + sizeof(fixed_point);
+	size_t window_cells = 2 * baseline_half_window + 1;
+	const char* stage_names[3] = { "anomaly climatology", "anomaly baseline", "anomaly scores" };
+	size_t cell_moments_size = sizeof(integer) + 2 * sizeof(cl_long);
+	double stage_bytes[3] = { (double)records_count * (record_size + cell_moments_size),
+		(double)cells * (window_cells * cell_moments_size + 2 * sizeof(floating_point)),
+		(double)records_count * (record_size + 2 * sizeof(floating_point)) + (double)anomaly_count * (sizeof(integer) + sizeof(floating_point)) };
+	double stage_operations[3] = { (double)records_count * 3, (double)cells * (window_cells * 3 + 6), (double)records_count * 3 };
+	for (size_t i = 0; i < 3; i++)
+		roofline_report(stage_names[i], events_profiling[i].getProfilingInfo<CL_PROFILING_COMMAND_END>() - events_profiling[i].getProfilingInfo<CL_PROFILING_COMMAND_START>(), stage_bytes[i], stage_operations[i]);
+	transfer_report("records upload", profiled_time(events_upload), (double)records_count * record_size, true);
+	transfer_report("read back", profiled_time(events_read), (double)sizeof(integer) + (double)anomaly_count * (sizeof(integer) + sizeof(floating_point)), false);
+
+	// The groups compact in any order - write the anomalies in record order
+	vector<size_t> order(anomaly_count);
+	iota(order.begin(), order.end(), 0);
+	sort(order.begin(), order.end(), [&](size_t a, size_t b) { return anomaly_index[a] < anomaly_index[b]; });
+
+	// Write the anomalies to a csv file
+	string file_name = "anomalies.csv";
+	ofstream ofs(file_name);
+	ofs << "station,year,month,day,time,temperature,z_score" << endl;
+	for (size_t i : order)
+	{
+		size_t record = anomaly_index[i];
+		ofs << station_names[records.station[record]] << ',' << timestamp_year(records.timestamp[record]) << ',' << timestamp_month(records.timestamp[record]) << ','
+			<< timestamp_day(records.timestamp[record]) << ',' << timestamp_time(records.timestamp[record]) << ',' << records.temperature[record] / 10.0f << ',' << anomaly_score[i] << endl;
+	}
+	cout << "WRITTEN TO: " << file_name << endl;
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// ****************************************************************************CORRELATIONS**************************************************************************
+
+// Stable radix sort of the keys and their values on device - 4 bit digits, a digit histogram per work group, its scan and a scatter per pass
+// The sorted keys and values are swapped into the given buffers - returns the kernel execution time
+// All passes are queued on the in order queue without blocking - the sort waits once for its last launch
+cl_ulong radix_sort(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_keys, cl::Buffer &buffer_values, size_t count, integer bits, size_t local_size)
+{
+	// Padded number of work items, groups and the histogram of 16 digits per group
+	size_t input_elements = round_up(count, local_size);
+	size_t groups = input_elements / local_size;
+	size_t histogram_elements = 16 * groups;
+
+	// Device - pooled sorted keys and values, the histogram and its scan
+	cl::Buffer buffer_sorted_keys = acquire_buffer(context, count * sizeof(cl_uint));
+	cl::Buffer buffer_sorted_values = acquire_buffer(context, count * sizeof(integer));
+	cl::Buffer buffer_histogram = acquire_buffer(context, histogram_elements * sizeof(integer));
+	cl::Buffer buffer_digit_offsets = acquire_buffer(context, histogram_elements * sizeof(integer));
+
+	// Kernel intialisation
+	cl::Kernel &kernel_histogram = cached_kernel(program, "radix_histogram");
+	kernel_histogram.setArg(1, buffer_histogram);
+	kernel_histogram.setArg(2, cl::Local(16 * sizeof(integer)));
+	kernel_histogram.setArg(4, (integer)count);
+
+	cl::Kernel &kernel_scatter = cached_kernel(program, "radix_scatter");
+	kernel_scatter.setArg(2, buffer_digit_offsets);
+	kernel_scatter.setArg(5, cl::Local(local_size * sizeof(cl_uint)));
+	kernel_scatter.setArg(6, cl::Local(local_size * sizeof(integer)));
+	kernel_scatter.setArg(7, cl::Local(local_size * sizeof(integer)));
+	kernel_scatter.setArg(8, cl::Local(16 * sizeof(integer)));
+	kernel_scatter.setArg(10, (integer)count);
+
+	vector<cl::Event> events_profiling, events_histogram, events_scatter;
+	vector<cl::Buffer> block_buffers;
+	for (integer shift = 0; shift < bits; shift += 4)
+	{
+		// Count the digits of each group
+		kernel_histogram.setArg(0, buffer_keys);
+		kernel_histogram.setArg(3, shift);
+		events_profiling.push_back(cl::Event());
+		queue.enqueueNDRangeKernel(kernel_histogram, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &events_profiling.back());
+		events_histogram.push_back(events_profiling.back());
+
+		// First position of every digit of every group - exclusive scan of the histogram
+		enqueue_scan<integer>(context, queue, program, buffer_histogram, buffer_digit_offsets, histogram_elements, local_size, false, "int", events_profiling, block_buffers);
+
+		// Scatter the keys and values on the digit
+		kernel_scatter.setArg(0, buffer_keys);
+		kernel_scatter.setArg(1, buffer_values);
+		kernel_scatter.setArg(3, buffer_sorted_keys);
+		kernel_scatter.setArg(4, buffer_sorted_values);
+		kernel_scatter.setArg(9, shift);
+		events_profiling.push_back(cl::Event());
+		queue.enqueueNDRangeKernel(kernel_scatter, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &events_profiling.back());
+		events_scatter.push_back(events_profiling.back());
+
+		// The sorted buffers are the input of the next digit
+		swap(buffer_keys, buffer_sorted_keys);
+		swap(buffer_values, buffer_sorted_values);
+	}
+
+	// Wait for the last pass
+	if (!events_profiling.empty())
+		events_profiling.back().wait();
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_sorted_keys, &buffer_sorted_values, &buffer_histogram, &buffer_digit_offsets })
+		release_buffer(*buffer);
+	for (cl::Buffer &buffer : block_buffers)
+		release_buffer(buffer);
+
+	// Every pass of the histogram reads the keys, shifts, masks and counts them and writes 16 counts per group - the launches between are the scan of the histogram
+	// The scan reads and writes the histogram, the scatter reads the keys, values and digit offsets and writes the keys and values - 4 splits of a local scan per key
+	cl_ulong histogram_time = profiled_time(events_histogram);
+	cl_ulong scatter_time = profiled_time(events_scatter);
+	cl_ulong execution_time = profiled_time(events_profiling);
+	double passes = (double)events_scatter.size();
+	double histogram_size = (double)histogram_elements * sizeof(integer);
+	roofline_report("radix histogram", histogram_time, passes * ((double)count * sizeof(cl_uint) + histogram_size), passes * count * 3);
+	roofline_report("radix digit scan", execution_time - histogram_time - scatter_time, passes * 2.0 * histogram_size, passes * 2.0 * histogram_elements);
+	roofline_report("radix scatter", scatter_time, passes * (2.0 * count * (sizeof(cl_uint) + sizeof(integer)) + histogram_size),
+		passes * count * 4 * (log2((double)local_size) + 3));
+
+	// Return the total execution time
+	return execution_time;
+}
+
+// Correlation of the temperatures of every pair of stations over their readings at the same times - written to a csv file
+void correlation_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size)
+{
+	// Number of records and stations
+	size_t records_count = records.temperature.size();
+	size_t stations = station_names.size();
+	size_t cells = stations * stations;
+
+	// Nothing to correlate
+	if (!records_count || stations < 2)
+	{
+		cout << "No pairs of stations to correlate" << endl;
+		return;
+	}
+
+	// Every co-moment of a group is accumulated in local memory - 6 int cells per pair of stations
+	cl_ulong local_memory = context.getInfo<CL_CONTEXT_DEVICES>()[0].getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+	if (6 * cells * sizeof(integer) > local_memory)
+	{
+		cout << "Too many stations to correlate in local memory: " << stations << endl;
+		return;
+	}
+
+	// Sort keys - the timestamps relative to the first, only the bits of the span are sorted
+	cl_uint first_timestamp = *min_element(records.timestamp.begin(), records.timestamp.end());
+	cl_uint last_timestamp = *max_element(records.timestamp.begin(), records.timestamp.end());
+	integer bits = 0;
+	while (bits < 32 && ((cl_ulong)(last_timestamp - first_timestamp) >> bits))
+		bits++;
+
+	// Keys and values - the station in the high half of a value and the temperature in the low half
+	vector<cl_uint> keys(records_count);
+	vector<integer> values(records_count);
+	for (size_t i = 0; i < records_count; i++)
+	{
+		keys[i] = records.timestamp[i] - first_timestamp;
+		values[i] = (records.station[i] << 16) | (cl_ushort)records.temperature[i];
+	}
+
+	// Size in bytes
+	size_t keys_size = records_count * sizeof(cl_uint);
+	size_t values_size = records_count * sizeof(integer);
+	size_t cell_size = cells * sizeof(cl_long);
+
+	// Device - pooled keys, values and co-moment buffers
+	cl::Buffer buffer_keys = acquire_buffer(context, keys_size);
+	cl::Buffer buffer_values = acquire_buffer(context, values_size);
+	vector<cl::Buffer> buffer_moments(6);
+	for (cl::Buffer &buffer : buffer_moments)
+	{
+		buffer = acquire_buffer(context, cell_size);
+		queue.enqueueFillBuffer(buffer, (cl_long)0, 0, cell_size);
+	}
+
+	// Copy the keys and values to device memory
+	vector<cl::Event> events_upload(2);
+	queue.enqueueWriteBuffer(buffer_keys, CL_TRUE, 0, keys_size, &keys[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_values, CL_TRUE, 0, values_size, &values[0], NULL, &events_upload[1]);
+
+	// Sort the records by timestamp - the readings of the same time become a run
+	cl_ulong sort_time = radix_sort(context, queue, program, buffer_keys, buffer_values, records_count, bits, local_size);
+
+	// Kernel intialisation
+	cl::Kernel &kernel_join = cached_kernel(program, "join_co_moments");
+	kernel_join.setArg(0, buffer_keys);
+	kernel_join.setArg(1, buffer_values);
+	for (cl_uint i = 0; i < 6; i++)
+	{
+		kernel_join.setArg(2 + i, buffer_moments[i]);
+		kernel_join.setArg(8 + i, cl::Local(cells * sizeof(integer)));
+	}
+	kernel_join.setArg(14, (integer)stations);
+	kernel_join.setArg(15, (integer)records_count);
+
+	// Join the runs and reduce the co-moments of every pair
+	cl::Event event_join_profiling;
+	queue.enqueueNDRangeKernel(kernel_join, cl::NullRange, cl::NDRange(round_up(records_count, local_size)), cl::NDRange(local_size), NULL, &event_join_profiling);
+
+	// Copy the co-moments from device to host - count, sums of a and b, sums of squares of a and b and sum of products
+	vector<vector<cl_long>> moments(6, vector<cl_long>(cells));
+	vector<cl::Event> events_read(6);
+	for (size_t i = 0; i < 6; i++)
+		queue.enqueueReadBuffer(buffer_moments[i], CL_TRUE, 0, cell_size, &moments[i][0], NULL, &events_read[i]);
+	cl_ulong join_time = event_join_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_join_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+
+	// Return the buffers to the pool
+	release_buffer(buffer_keys);
+	release_buffer(buffer_values);
+	for (cl::Buffer &buffer : buffer_moments)
+		release_buffer(buffer);
+
+	// Covariance and correlation of each pair - over the readings the pair has in common, in degrees
+	vector<double> covariance(cells, 0.0), correlation(cells, 1.0);
+	double pairs = 0.0;
+	for (size_t a = 0; a < stations; a++)
+		for (size_t b = a + 1; b < stations; b++)
+		{
+			size_t cell = a * stations + b;
+			double n = (double)moments[0][cell];
+			pairs += n;
+			double sum_a = moments[1][cell] / 10.0, sum_b = moments[2][cell] / 10.0;
+			double sum_aa = moments[3][cell] / 100.0, sum_bb = moments[4][cell] / 100.0, sum_ab = moments[5][cell] / 100.0;
+			double variance_a = n ? (sum_aa - sum_a * sum_a / n) / n : 0.0;
+			double variance_b = n ? (sum_bb - sum_b * sum_b / n) / n : 0.0;
+			covariance[cell] = covariance[b * stations + a] = n ? (sum_ab - sum_a * sum_b / n) / n : 0.0;
+			correlation[cell] = correlation[b * stations + a] = (variance_a > 0.0 && variance_b > 0.0) ? covariance[cell] / sqrt(variance_a * variance_b) : 0.0;
+		}
+
+	// Display the correlation matrix
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "CORRELATION OF THE STATIONS OVER THEIR READINGS AT THE SAME TIMES" << endl;
+	cout << "Radix sort of " << bits << " bits [nano-seconds]: " << sort_time << "\t|| Join and co-moment reduction [nano-seconds]: " << join_time << endl;
+
+	// The join reads every key and value and the key and value of every joined pair - a pair orders, multiplies and adds its 6 co-moments, every cell is merged once
+	roofline_report("join co-moments", join_time, (double)(keys_size + values_size) + pairs * (sizeof(cl_uint) + sizeof(integer)) + 6.0 * cell_size, pairs * 14);
+	transfer_report("keys and values upload", profiled_time(events_upload), (double)(keys_size + values_size), true);
+	transfer_report("read back", profiled_time(events_read), 6.0 * cell_size, false);
+	cout << "STATION\t";
+	for (size_t b = 0; b < stations; b++)
+		cout << "\t|| " << station_names[b];
+	cout << endl;
+	for (size_t a = 0; a < stations; a++)
+	{
+		cout << station_names[a] << "\t";
+		for (size_t b = 0; b < stations; b++)
+			cout << "\t|| " << round(correlation[a * stations + b] * 1000.0) / 1000.0;
+		cout << endl;
+	}
+
+	// Write every pair to a csv file
+	string file_name = "correlation.csv";
+	ofstream ofs(file_name);
+	ofs << "station_a,station_b,readings,covariance,correlation" << endl;
+	for (size_t a = 0; a < stations; a++)
+		for (size_t b = a + 1; b < stations; b++)
+			ofs << station_names[a] << ',' << station_names[b] << ',' << moments[0][a * stations + b] << ','
+				<< covariance[a * stations + b] << ',' << correlation[a * stations + b] << endl;
+	cout << "WRITTEN TO: " << file_name << endl;
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// *******************************************************************************ROOFLINE***************************************************************************
+
+// Measure the peak bandwidth of the device with the STREAM copy kernel, its theoretical compute from the compute units and clock and the bandwidth of the transfers
+// The theoretical compute assumes every compute unit retires a fused multiply add on each lane of its native float vector per cycle
+void measure_device_peaks(cl::Context &context, cl::CommandQueue &queue, cl::Program &program)
+{
+	// Device of the context
+	cl::Device peak_device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+
+	// Size of the copied buffers - a quarter of the largest allocation up to 64MB, a whole number of float vectors
+	cl_ulong max_allocation = peak_device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+	size_t copy_size = (size_t)min(max_allocation / 4, (cl_ulong)(64 << 20)) / sizeof(cl_float4) * sizeof(cl_float4);
+
+	// Device - pooled input and output buffers, the input filled so the first copy reads initialised memory
+	cl::Buffer buffer_input = acquire_buffer(context, copy_size);
+	cl::Buffer buffer_output = acquire_buffer(context, copy_size);
+	queue.enqueueFillBuffer(buffer_input, 0.0f, 0, copy_size);
+
+	// Kernel intialisation
+	cl::Kernel &kernel_copy = cached_kernel(program, "stream_copy");
+	kernel_copy.setArg(0, buffer_input);
+	kernel_copy.setArg(1, buffer_output);
+
+	// Best of several copies - bytes read and written per nano-second is GB/s
+	cl_ulong best_time = ULLONG_MAX;
+	for (int repeat = 0; repeat < 5; repeat++)
+	{
+		cl::Event event_copy_profiling;
+		queue.enqueueNDRangeKernel(kernel_copy, cl::NullRange, cl::NDRange(copy_size / sizeof(cl_float4)), cl::NullRange, NULL, &event_copy_profiling);
+		event_copy_profiling.wait();
+		best_time = min(best_time, (cl_ulong)(event_copy_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_copy_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>()));
+	}
+	peaks.bandwidth = 2.0 * copy_size / best_time;
+
+	// Theoretical compute - compute units x clock [MHz] x float lanes x 2 operations of a fused multiply add, in GFLOP/s
+	cl_uint compute_units = peak_device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+	cl_uint clock_frequency = peak_device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
+	cl_uint float_lanes = max((cl_uint)peak_device.getInfo<CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT>(), (cl_uint)1);
+	peaks.compute = (double)compute_units * clock_frequency * float_lanes * 2.0 / 1000.0;
+
+	// Best of several blocking transfers of the same size from and to host memory - the transfers run over the bus, not the memory of the device
+	vector<char> host_buffer(copy_size);
+	cl_ulong best_upload_time = ULLONG_MAX;
+	cl_ulong best_download_time = ULLONG_MAX;
+	for (int repeat = 0; repeat < 5; repeat++)
+	{
+		cl::Event event_upload;
+		cl::Event event_download;
+		queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, copy_size, &host_buffer[0], NULL, &event_upload);
+		queue.enqueueReadBuffer(buffer_output, CL_TRUE, 0, copy_size, &host_buffer[0], NULL, &event_download);
+		best_upload_time = min(best_upload_time, (cl_ulong)(event_upload.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_upload.getProfilingInfo<CL_PROFILING_COMMAND_START>()));
+		best_download_time = min(best_download_time, (cl_ulong)(event_download.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_download.getProfilingInfo<CL_PROFILING_COMMAND_START>()));
+	}
+	peaks.upload = (double)copy_size / best_upload_time;
+	peaks.download = (double)copy_size / best_download_time;
+
+	// Return the buffers to the pool
+	release_buffer(buffer_input);
+	release_buffer(buffer_output);
+
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "DEVICE PEAKS" << endl;
+	cout << "STREAM copy [bytes]: " << copy_size << "\t|| best of 5 [nano-seconds]: " << best_time << "\t|| PEAK BANDWIDTH [GB/s]: " << peaks.bandwidth << endl;
+	cout << "Compute units: " << compute_units << "\t|| clock [MHz]: " << clock_frequency << "\t|| float lanes: " << float_lanes << "\t|| PEAK COMPUTE [GFLOP/s]: " << peaks.compute << endl;
+	cout << "Ridge point [FLOP/byte]: " << peaks.compute / peaks.bandwidth << endl;
+	cout << "Host to device [GB/s]: " << peaks.upload << "\t|| device to host [GB/s]: " << peaks.download << "\t|| best of 5 transfers of " << copy_size << " bytes" << endl;
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// Achieved bandwidth and compute of a kernel against the peaks of the device
+// A kernel below the ridge point can at best reach the peak bandwidth - it is memory bound
+void roofline_report(const string &name, cl_ulong execution_time, double bytes, double operations)
+{
+	// Only with the peaks measured
+	if (!run_roofline || !execution_time) return;
+
+	// Bytes and operations per nano-second are GB/s and GFLOP/s
+	double bandwidth = bytes / execution_time;
+	double compute = operations / execution_time;
+	double intensity = bytes ? operations / bytes : 0.0;
+	bool memory_bound = intensity * peaks.bandwidth < peaks.compute;
+
+	cout << "ROOFLINE " << name << "\t|| [GB/s]: " << bandwidth << " (" << 100.0 * bandwidth / peaks.bandwidth << "% of peak)"
+		<< "\t|| [GFLOP/s]: " << compute << " (" << 100.0 * compute / peaks.compute << "% of peak)"
+		<< "\t|| [FLOP/byte]: " << intensity << "\t|| " << (memory_bound ? "MEMORY BOUND" : "COMPUTE BOUND") << endl;
+}
+
+// Achieved bandwidth of a transfer against the measured bandwidth of the transfers in its direction
+// A transfer does no compute and is limited by the bus between host and device - it has no place on the roofline of the device
+void transfer_report(const string &name, cl_ulong transfer_time, double bytes, bool upload)
+{
+	// Only with the peaks measured
+	if (!run_roofline || !transfer_time) return;
+
+	// Bytes per nano-second are GB/s
+	double bandwidth = bytes / transfer_time;
+	double peak = upload ? peaks.upload : peaks.download;
+	cout << "TRANSFER " << name << "\t|| [GB/s]: " << bandwidth << " (" << 100.0 * bandwidth / peak << "% of the measured " << (upload ? "host to device" : "device to host") << " bandwidth)" << endl;
+}
+
+// Sum of the profiled times of a set of commands
+// The commands of a blocking call are complete on its return so their profiling is always available
+cl_ulong profiled_time(const vector<cl::Event> &events)
+{
+	cl_ulong time = 0;
+	for (const cl::Event &event : events)
+		time += event.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	return time;
+}
+
+// *******************************************************************************PIPELINE***************************************************************************
+
+// Parse the records starting in a byte range of the file into chunks of temperatures and push them to the queue
+// A line belongs to the range it starts in - a range starting inside a line skips to the next line
+// Compressed input cannot be split - its single range is parsed from the decompressed lines
+void parse_range(const char* file, streamoff begin, streamoff end, size_t chunk_records, bounded_queue<vector<fixed_point>, 8> &chunks, cl_ulong &parse_time)
+{
+	// Start of the parsing
+	hi_res_time_point start_of_parse = hi_res_clock::now();
+
+	// Parse a line into the chunk - a full chunk waits for room in the queue
+	vector<fixed_point> chunk;
+	chunk.reserve(chunk_records);
+	auto parse_line = [&](const string &line)
+	{
+		if (line.find_first_not_of(" \r") == string::npos) return;
+		chunk.push_back(parse_string_to_int(line));
+		if (chunk.size() == chunk_records)
+		{
+			while (!chunks.try_push(chunk))
+				this_thread::yield();
+			chunk.clear();
+			chunk.reserve(chunk_records);
+		}
+	};
+
+	// Compressed input - every decompressed line, an unreadable file stops the program
+	if (detect_compression(file) != plain_text)
+	{
+		if (!read_lines(file, parse_line))
+		{
+			cerr << "Cannot read the input file: " << file << endl;
+			exit(1);
+		}
+	}
+
+	// Plain text - the lines starting in the range
+	else
+	{
+		// Input file stream - binary so the offsets are exact byte positions
+		ifstream ifs(file, ios::binary);
+		string line;
+
+		// Position of the first line starting in the range
+		streamoff position = begin;
+		if (begin > 0)
+		{
+			ifs.seekg(begin - 1);
+			getline(ifs, line);
+			position = begin - 1 + (streamoff)line.size() + 1;
+		}
+
+		while (position < end && getline(ifs, line))
+		{
+			position += (streamoff)line.size() + 1;
+			parse_line(line);
+		}
+	}
+
+	// Last partial chunk
+	if (!chunk.empty())
+		while (!chunks.try_push(chunk))
+			this_thread::yield();
+
+	parse_time = chrono::duration_cast<chrono::nanoseconds>(hi_res_clock::now() - start_of_parse).count();
+}
+
+// Pipelined ingest - parser threads, the upload of each chunk and its reduction overlap
+// The calling thread uploads every chunk as it arrives without blocking, the reduction of a chunk waits only for its own upload
+// A ring of slots bounds the chunks in flight - a slot is reused once the reduction of its last chunk has completed
+void pipeline_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size)
+{
+	// Start of the pipeline
+	hi_res_time_point start_of_pipeline = hi_res_clock::now();
+
+	// Records per chunk - whole work groups
+	const size_t chunk_records = round_up(1 << 16, local_size);
+	const size_t pipeline_depth = 4;
+
+	// Size of the file
+	ifstream ifs(file, ios::binary | ios::ate);
+	if (!ifs.is_open())
+	{
+		cerr << "Cannot read the input file: " << (file != nullptr ? file : "") << endl;
+		exit(1);
+	}
+	streamoff file_size = (streamoff)ifs.tellg();
+	ifs.close();
+
+	// Parser threads - one byte range of the file each, a compressed file is a single range
+	size_t parsers = detect_compression(file) != plain_text ? 1 : max(thread::hardware_concurrency(), 2u) - 1;
+	bounded_queue<vector<fixed_point>, 8> chunks;
+	vector<cl_ulong> parse_times(parsers, 0);
+	atomic<size_t> parsers_done{ 0 };
+	vector<thread> parser_threads;
+	for (size_t i = 0; i < parsers; i++)
+		parser_threads.emplace_back([&, i]()
+		{
+			parse_range(file, file_size * i / parsers, file_size * (i + 1) / parsers, chunk_records, chunks, parse_times[i]);
+			parsers_done++;
+		});
+
+	// Device - the moments of all chunks, every group of a chunk belongs to dataset 0
+	size_t groups = chunk_records / local_size;
+	cl::Buffer buffer_group_dataset = acquire_buffer(context, groups * sizeof(integer));
+	cl::Buffer buffer_dataset_offset = acquire_buffer(context, sizeof(integer));
+	cl::Buffer buffer_sum = acquire_buffer(context, sizeof(cl_long));
+	cl::Buffer buffer_sum_squares = acquire_buffer(context, sizeof(cl_long));
+	cl::Buffer buffer_min = acquire_buffer(context, sizeof(integer));
+	cl::Buffer buffer_max = acquire_buffer(context, sizeof(integer));
+	vector<cl::Event> events_fill(6);
+	queue.enqueueFillBuffer(buffer_group_dataset, 0, 0, groups * sizeof(integer), NULL, &events_fill[0]);
+	queue.enqueueFillBuffer(buffer_dataset_offset, 0, 0, sizeof(integer), NULL, &events_fill[1]);
+	queue.enqueueFillBuffer(buffer_sum, (cl_long)0, 0, sizeof(cl_long), NULL, &events_fill[2]);
+	queue.enqueueFillBuffer(buffer_sum_squares, (cl_long)0, 0, sizeof(cl_long), NULL, &events_fill[3]);
+	queue.enqueueFillBuffer(buffer_min, INT_MAX, 0, sizeof(integer), NULL, &events_fill[4]);
+	queue.enqueueFillBuffer(buffer_max, INT_MIN, 0, sizeof(integer), NULL, &events_fill[5]);
+
+	// Kernel intialisation - the shared arguments
+	cl::Kernel &kernel_moments = cached_kernel(program, "segmented_moments");
+	kernel_moments.setArg(1, buffer_group_dataset);
+	kernel_moments.setArg(2, buffer_dataset_offset);
+	kernel_moments.setArg(4, buffer_sum);
+	kernel_moments.setArg(5, buffer_sum_squares);
+	kernel_moments.setArg(6, buffer_min);
+	kernel_moments.setArg(7, buffer_max);
+	for (cl_uint i = 8; i < 12; i++)
+		kernel_moments.setArg(i, cl::Local(local_size * sizeof(integer)));
+
+	// Ring of slots - the host chunk and its count stay alive until the reduction of the chunk has completed
+	struct pipeline_slot
+	{
+		vector<fixed_point> chunk;
+		integer count = 0;
+		cl::Buffer buffer_input;
+		cl::Buffer buffer_count;
+		vector<cl::Event> events;
+		bool busy = false;
+	};
+	vector<pipeline_slot> slots(pipeline_depth);
+	for (pipeline_slot &slot : slots)
+	{
+		slot.buffer_input = acquire_buffer(context, chunk_records * sizeof(fixed_point));
+		slot.buffer_count = acquire_buffer(context, sizeof(integer));
+	}
+
+	// Retire the chunk of a slot - wait for its reduction and add up its times
+	size_t records_count = 0, chunks_count = 0, input_elements = 0;
+	cl_ulong transfer_time = 0, execution_time = 0;
+	auto retire = [&](pipeline_slot &slot)
+	{
+		if (!slot.busy) return;
+		slot.events.back().wait();
+		for (size_t i = 0; i < slot.events.size(); i++)
+		{
+			cl_ulong time = slot.events[i].getProfilingInfo<CL_PROFILING_COMMAND_END>() - slot.events[i].getProfilingInfo<CL_PROFILING_COMMAND_START>();
+			if (i + 1 < slot.events.size()) transfer_time += time;
+			else execution_time += time;
+		}
+		slot.busy = false;
+	};
+
+	// Upload and reduce the chunks as they arrive until every parser is done and the queue is empty
+	hi_res_time_point start_of_first_chunk;
+	for (size_t next_slot = 0;; )
+	{
+		// Next chunk - the parsers are checked before the queue so no chunk pushed before the last parser finished is missed
+		vector<fixed_point> chunk;
+		bool finished = parsers_done.load() == parsers;
+		if (!chunks.try_pop(chunk))
+		{
+			if (finished) break;
+			this_thread::yield();
+			continue;
+		}
+		if (!chunks_count++) start_of_first_chunk = hi_res_clock::now();
+
+		// Free the slot
+		pipeline_slot &slot = slots[next_slot];
+		next_slot = (next_slot + 1) % pipeline_depth;
+		retire(slot);
+		slot.chunk = move(chunk);
+		slot.count = (integer)slot.chunk.size();
+		records_count += slot.chunk.size();
+		input_elements += round_up(slot.chunk.size(), local_size);
+
+		// Non blocking upload of the chunk and its count - behind the fills
+		slot.events.assign(3, cl::Event());
+		queue.enqueueWriteBuffer(slot.buffer_input, CL_FALSE, 0, slot.chunk.size() * sizeof(fixed_point), &slot.chunk[0], &events_fill, &slot.events[0]);
+		queue.enqueueWriteBuffer(slot.buffer_count, CL_FALSE, 0, sizeof(integer), &slot.count, &events_fill, &slot.events[1]);
+
+		// Reduce the chunk once its upload has completed
+		vector<cl::Event> wait_upload = { slot.events[0], slot.events[1] };
+		kernel_moments.setArg(0, slot.buffer_input);
+		kernel_moments.setArg(3, slot.buffer_count);
+		queue.enqueueNDRangeKernel(kernel_moments, cl::NullRange, cl::NDRange(round_up(slot.chunk.size(), local_size)), cl::NDRange(local_size), &wait_upload, &slot.events[2]);
+		queue.flush();
+		slot.busy = true;
+	}
+
+	// Wait for the last chunks
+	for (thread &parser : parser_threads)
+		parser.join();
+	for (pipeline_slot &slot : slots)
+		retire(slot);
+
+	// Copy the result from device to host
+	cl_long sum = 0, sum_squares = 0;
+	integer minimum = INT_MAX, maximum = INT_MIN;
+	vector<cl::Event> events_read(4);
+	queue.enqueueReadBuffer(buffer_sum, CL_TRUE, 0, sizeof(cl_long), &sum, NULL, &events_read[0]);
+	queue.enqueueReadBuffer(buffer_sum_squares, CL_TRUE, 0, sizeof(cl_long), &sum_squares, NULL, &events_read[1]);
+	queue.enqueueReadBuffer(buffer_min, CL_TRUE, 0, sizeof(integer), &minimum, NULL, &events_read[2]);
+	queue.enqueueReadBuffer(buffer_max, CL_TRUE, 0, sizeof(integer), &maximum, NULL, &events_read[3]);
+	auto time_elapsed_pipeline = chrono::duration_cast<chrono::nanoseconds>(hi_res_clock::now() - start_of_pipeline).count();
+
+	// Return the buffers to the pool
+	for (pipeline_slot &slot : slots)
+	{
+		release_buffer(slot.buffer_input);
+		release_buffer(slot.buffer_count);
+	}
+	for (cl::Buffer *buffer : { &buffer_group_dataset, &buffer_dataset_offset, &buffer_sum, &buffer_sum_squares, &buffer_min, &buffer_max })
+		release_buffer(*buffer);
+
+	// Dsiaply info - the stages overlap so the end to end time approaches the longest stage rather than their sum
+	number_of_data_entries = records_count;
+	cl_ulong parse_time = *max_element(parse_times.begin(), parse_times.end());
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "PIPELINED INGEST" << endl;
+	cout << "Parser threads: " << parsers << "\t|| chunks: " << chunks_count << " of " << chunk_records << " records\t|| slots in flight: " << pipeline_depth << endl;
+	cout << "Parse [nano-seconds]: " << parse_time << "\t|| upload [nano-seconds]: " << transfer_time << "\t|| reduce [nano-seconds]: " << execution_time << endl;
+	cout << "Sum of the stages [nano-seconds]: " << parse_time + transfer_time + execution_time << "\t|| end to end [nano-seconds]: " << time_elapsed_pipeline << endl;
+	cout << "RECORDS: " << records_count << endl;
+	if (records_count)
+	{
+		// Convert the fixed point moments - temperatures are in tenths
+		double mean = (double)sum / records_count;
+		double variance = max((double)sum_squares / records_count - mean * mean, 0.0);
+		cout << "MAX TEMPERATURE: " << maximum / 10.0f << endl;
+		cout << "MIN TEMPERATURE: " << minimum / 10.0f << endl;
+		cout << "MEAN TEMPERATURE: " << mean / 10.0 << endl;
+		cout << "VARIANCE: " << variance / 100.0 << endl;
+		cout << "STANDARD DEVIATION: " << sqrt(variance) / 10.0 << endl;
+	}
+
+	// Every launch reads the shorts of its chunk and the dataset of each work group and merges four moments per work group - as the segmented moments of the datasets
+	size_t work_groups = input_elements / local_size;
+	roofline_report("segmented moments of the chunks", execution_time, (double)records_count * sizeof(fixed_point) + (double)work_groups * (3 * sizeof(integer) + 2 * sizeof(cl_long) + 2 * sizeof(integer)),
+		(double)input_elements * 5);
+	transfer_report("chunk uploads", transfer_time, (double)records_count * sizeof(fixed_point) + (double)chunks_count * sizeof(integer), true);
+	transfer_report("read back", profiled_time(events_read), (double)(2 * sizeof(cl_long) + 2 * sizeof(integer)), false);
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// ******************************************************************************BOOTSTRAP***************************************************************************
+
+// Percentile bootstrap confidence intervals of the mean and standard deviation - the replicates are resampled on device
+// Every replicate is one work group, its indices come from a counter based generator keyed by the seed so a seed always gives the same intervals
+void bootstrap_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t records_count, size_t replicates, cl_ulong seed, size_t local_size)
+{
+	// Nothing to resample
+	if (!records_count)
+	{
+		cout << "No records to resample" << endl;
+		return;
+	}
+
+	// Size in bytes - the replicates and the sample itself
+	size_t replicate_size = (replicates + 1) * sizeof(cl_long);
+
+	// Device - pooled sums of the replicates
+	cl::Buffer buffer_sum = acquire_buffer(context, replicate_size);
+	cl::Buffer buffer_sum_squares = acquire_buffer(context, replicate_size);
+
+	// Kernel intialisation
+	cl::Kernel &kernel_bootstrap = cached_kernel(program, "bootstrap_moments");
+	kernel_bootstrap.setArg(0, buffer_input);
+	kernel_bootstrap.setArg(1, buffer_sum);
+	kernel_bootstrap.setArg(2, buffer_sum_squares);
+	kernel_bootstrap.setArg(3, cl::Local(local_size * sizeof(cl_long)));
+	kernel_bootstrap.setArg(4, cl::Local(local_size * sizeof(cl_long)));
+	kernel_bootstrap.setArg(5, (cl_uint)seed);
+	kernel_bootstrap.setArg(6, (cl_uint)(seed >> 32));
+	kernel_bootstrap.setArg(7, (integer)records_count);
+
+	// Call the kernel - one work group per replicate and the last for the sample itself
+	cl::Event event_bootstrap_profiling;
+	queue.enqueueNDRangeKernel(kernel_bootstrap, cl::NullRange, cl::NDRange((replicates + 1) * local_size), cl::NDRange(local_size), NULL, &event_bootstrap_profiling);
+
+	// Copy the result from device to host
+	vector<cl_long> sum(replicates + 1), sum_squares(replicates + 1);
+	vector<cl::Event> events_read(2);
+	queue.enqueueReadBuffer(buffer_sum, CL_TRUE, 0, replicate_size, &sum[0], NULL, &events_read[0]);
+	queue.enqueueReadBuffer(buffer_sum_squares, CL_TRUE, 0, replicate_size, &sum_squares[0], NULL, &events_read[1]);
+	cl_ulong execution_time = event_bootstrap_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_bootstrap_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+
+	// Return the buffers to the pool
+	release_buffer(buffer_sum);
+	release_buffer(buffer_sum_squares);
+
+	// Mean and standard deviation of every replicate and of the sample - M2 from the exact fixed point sums, temperatures are in tenths
+	vector<double> means(replicates + 1), std_devs(replicates + 1);
+	for (size_t i = 0; i <= replicates; i++)
+	{
+		double m2 = (double)sum_squares[i] - (double)sum[i] * sum[i] / records_count;
+		means[i] = sum[i] / 10.0 / records_count;
+		std_devs[i] = sqrt(max(m2, 0.0) / records_count) / 10.0;
+	}
+
+	// Point estimates of the sample - the replicates are sorted for their percentiles
+	double sample_mean = means.back(), sample_std_dev = std_devs.back();
+	means.pop_back();
+	std_devs.pop_back();
+	sort(means.begin(), means.end());
+	sort(std_devs.begin(), std_devs.end());
+
+	// Percentiles of the replicates - the central 95%
+	size_t lower = (size_t)floor(0.025 * (replicates - 1));
+	size_t upper = (size_t)ceil(0.975 * (replicates - 1));
+
+	// Dsiaply info - the point estimates are from the exact fixed point sums of the sample, as the intervals
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "BOOTSTRAP CONFIDENCE INTERVALS - 95% PERCENTILE" << endl;
+	cout << "Replicates: " << replicates << "\t|| records per replicate: " << records_count << "\t|| seed: " << seed << endl;
+	cout << "Total kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time << endl;
+	cout << "MEAN TEMPERATURE: " << sample_mean << "\t|| 95% CI: [" << means[lower] << ", " << means[upper] << "]" << endl;
+	cout << "STANDARD DEVIATION: " << sample_std_dev << "\t|| 95% CI: [" << std_devs[lower] << ", " << std_devs[upper] << "]" << endl;
+
+	// Every replicate and the sample read a short per record and write their two sums - the input is already on device
+	// A draw costs a quarter of the 10 rounds of 10 operations of the generator, the index and the sum and square of its value
+	roofline_report("bootstrap moments", execution_time, (double)(replicates + 1) * records_count * sizeof(fixed_point) + 2.0 * replicate_size,
+		(double)replicates * records_count * (25 + 4) + (double)records_count * 3);
+	transfer_report("read back", profiled_time(events_read), 2.0 * replicate_size, false);
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// *******************************************************************************SPELLS*****************************************************************************
+
+// Frost and hot readings of every station and year and their longest spells - written to a csv file
+// Per condition a count-if pass writes the run breaks of the records ordered by station and time, the max-scan of the breaks gives the start of the run
+// of every record and a second pass keeps the longest run of every station and year - frost is below 0 and hot above each threshold
+void spell_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, const vector<floating_point> &hot_thresholds, size_t local_size)
+{
+	// Number of records and the padded number of work items
+	size_t records_count = records.temperature.size();
+	size_t input_elements = round_up(records_count, local_size);
+
+	// Nothing to count
+	if (!records_count)
+	{
+		cout << "No records to count" << endl;
+		return;
+	}
+
+	// Range of years of the records - one cell per station and year
+	integer first_year = INT_MAX, last_year = INT_MIN;
+	for (cl_uint timestamp : records.timestamp)
+	{
+		first_year = min(first_year, timestamp_year(timestamp));
+		last_year = max(last_year, timestamp_year(timestamp));
+	}
+	integer years = last_year - first_year + 1;
+	size_t cells = station_names.size() * years;
+
+	// Conditions - frost, then every hot threshold in fixed point tenths
+	vector<string> names = { "frost" };
+	vector<integer> thresholds = { 0 };
+	vector<integer> above = { 0 };
+	for (floating_point threshold : hot_thresholds)
+	{
+		stringstream name;
+		name << "hot above " << threshold;
+		names.push_back(name.str());
+		thresholds.push_back((integer)lround(threshold * 10.0f));
+		above.push_back(1);
+	}
+
+	// Size in bytes
+	size_t station_size = records_count * sizeof(cl_uchar);
+	size_t timestamp_size = records_count * sizeof(cl_uint);
+	size_t input_size = records_count * sizeof(fixed_point);
+	size_t breaks_size = records_count * sizeof(integer);
+	size_t cell_size_int = cells * sizeof(integer);
+	size_t cell_size_long = cells * sizeof(cl_long);
+
+	// Device - pooled column, break and cell buffers - the columns stay resident for every condition
+	cl::Buffer buffer_station = acquire_buffer(context, station_size);
+	cl::Buffer buffer_timestamp = acquire_buffer(context, timestamp_size);
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+	cl::Buffer buffer_breaks = acquire_buffer(context, breaks_size);
+	cl::Buffer buffer_last_break = acquire_buffer(context, breaks_size);
+	cl::Buffer buffer_count = acquire_buffer(context, cell_size_int);
+	cl::Buffer buffer_spell = acquire_buffer(context, cell_size_long);
+
+	// Copy the columns to device memory
+	vector<cl::Event> events_upload(3);
+	queue.enqueueWriteBuffer(buffer_station, CL_TRUE, 0, station_size, &records.station[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_timestamp, CL_TRUE, 0, timestamp_size, &records.timestamp[0], NULL, &events_upload[1]);
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &records.temperature[0], NULL, &events_upload[2]);
+
+	// Kernel intialisation - the threshold is set per condition
+	cl::Kernel &kernel_events = cached_kernel(program, "threshold_events");
+	kernel_events.setArg(0, buffer_station);
+	kernel_events.setArg(1, buffer_timestamp);
+	kernel_events.setArg(2, buffer_input);
+	kernel_events.setArg(3, buffer_breaks);
+	kernel_events.setArg(4, buffer_count);
+	kernel_events.setArg(5, cl::Local(local_size * sizeof(integer)));
+	kernel_events.setArg(8, first_year);
+	kernel_events.setArg(9, years);
+	kernel_events.setArg(10, (integer)records_count);
+
+	cl::Kernel &kernel_spells = cached_kernel(program, "spell_lengths");
+	kernel_spells.setArg(0, buffer_station);
+	kernel_spells.setArg(1, buffer_timestamp);
+	kernel_spells.setArg(2, buffer_input);
+	kernel_spells.setArg(3, buffer_last_break);
+	kernel_spells.setArg(4, buffer_spell);
+	kernel_spells.setArg(7, first_year);
+	kernel_spells.setArg(8, years);
+	kernel_spells.setArg(9, (integer)records_count);
+
+	// Counts and packed longest spells of every condition and cell
+	vector<vector<integer>> counts(names.size(), vector<integer>(cells));
+	vector<vector<cl_long>> spells(names.size(), vector<cl_long>(cells));
+	cl_ulong execution_time = 0, events_time = 0, scan_time = 0, spells_time = 0, transfer_time = 0;
+	for (size_t condition = 0; condition < names.size(); condition++)
+	{
+		// Zero the cells
+		queue.enqueueFillBuffer(buffer_count, 0, 0, cell_size_int);
+		queue.enqueueFillBuffer(buffer_spell, (cl_long)0, 0, cell_size_long);
+
+		kernel_events.setArg(6, thresholds[condition]);
+		kernel_events.setArg(7, above[condition]);
+		kernel_spells.setArg(5, thresholds[condition]);
+		kernel_spells.setArg(6, above[condition]);
+
+		// Count-if and breaks, the inclusive max-scan of the breaks, then the longest runs
+		vector<cl::Event> events_profiling(2);
+		queue.enqueueNDRangeKernel(kernel_events, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &events_profiling[0]);
+		scan_time += parallel_scan<integer>(context, queue, program, buffer_breaks, buffer_last_break, records_count, local_size, true, "max_int");
+		queue.enqueueNDRangeKernel(kernel_spells, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &events_profiling[1]);
+
+		// Copy the result from device to host
+		vector<cl::Event> events_read(2);
+		queue.enqueueReadBuffer(buffer_count, CL_TRUE, 0, cell_size_int, &counts[condition][0], NULL, &events_read[0]);
+		queue.enqueueReadBuffer(buffer_spell, CL_TRUE, 0, cell_size_long, &spells[condition][0], NULL, &events_read[1]);
+		events_time += events_profiling[0].getProfilingInfo<CL_PROFILING_COMMAND_END>() - events_profiling[0].getProfilingInfo<CL_PROFILING_COMMAND_START>();
+		spells_time += events_profiling[1].getProfilingInfo<CL_PROFILING_COMMAND_END>() - events_profiling[1].getProfilingInfo<CL_PROFILING_COMMAND_START>();
+		transfer_time += profiled_time(events_read);
+	}
+	execution_time = events_time + scan_time + spells_time;
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_station, &buffer_timestamp, &buffer_input, &buffer_breaks, &buffer_last_break, &buffer_count, &buffer_spell })
+		release_buffer(*buffer);
+
+	// Decode a packed spell - the length in the high half, the complement of its last record in the low half
+	auto spell_length = [](cl_long spell) { return (integer)(spell >> 32); };
+	auto spell_end = [](cl_long spell) { return (size_t)(~(cl_uint)spell); };
+
+	// Dsiaply info - the total of every condition and its longest spell of all stations and years
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "FROST AND HOT READINGS AND SPELLS PER STATION AND YEAR" << endl;
+	cout << "Total kernel luanches: " << names.size() << " x (2 + scan) \t|| Total time for all executions [nano-seconds]: " << execution_time << endl;
+
+	// Per condition the count-if reads every record and its neighbour, writes its break and merges its window of cells, the scan reads and writes the breaks
+	// and the spells read every record, its neighbour and its last break - the event test, the segment start and the cell are a few integer operations each
+	size_t record_size = sizeof(cl_uchar) + sizeof(cl_uint) + sizeof(fixed_point);
+	double conditions = (double)names.size();
+	roofline_report("threshold events", events_time, conditions * ((double)records_count * (record_size + sizeof(integer)) + (double)cell_size_int), conditions * records_count * 8);
+	roofline_report("spell max-scan", scan_time, conditions * 2.0 * breaks_size, conditions * 2.0 * records_count);
+	roofline_report("spell lengths", spells_time, conditions * ((double)records_count * (record_size + sizeof(integer)) + (double)cell_size_long), conditions * records_count * 8);
+	transfer_report("records upload", profiled_time(events_upload), (double)records_count * record_size, true);
+	transfer_report("read back", transfer_time, conditions * (cell_size_int + cell_size_long), false);
+	for (size_t condition = 0; condition < names.size(); condition++)
+	{
+		cl_ulong total = 0;
+		size_t longest = 0;
+		for (size_t cell = 0; cell < cells; cell++)
+		{
+			total += counts[condition][cell];
+			if (spells[condition][cell] > spells[condition][longest]) longest = cell;
+		}
+		cout << names[condition] << " readings: " << total << " OF " << records_count;
+		if (spell_length(spells[condition][longest]))
+		{
+			integer length = spell_length(spells[condition][longest]);
+			size_t end = spell_end(spells[condition][longest]);
+			cout << "\t|| longest spell: " << length << " readings from " << describe_record(records, end - length + 1) << " to " << describe_record(records, end);
+		}
+		cout << endl;
+	}
+
+	// Write the counts and longest spells of every station and year to a csv file
+	string file_name = "spells.csv";
+	ofstream ofs(file_name);
+	ofs << "station,year,condition,readings,longest_spell,spell_start,spell_end" << endl;
+	for (size_t cell = 0; cell < cells; cell++)
+		for (size_t condition = 0; condition < names.size(); condition++)
+		{
+			integer length = spell_length(spells[condition][cell]);
+			ofs << station_names[cell / years] << ',' << first_year + (integer)(cell % years) << ',' << names[condition] << ',' << counts[condition][cell] << ',' << length;
+			if (length)
+			{
+				size_t end = spell_end(spells[condition][cell]);
+				size_t start = end - length + 1;
+				ofs << ',' << timestamp_year(records.timestamp[start]) << '-' << timestamp_month(records.timestamp[start]) << '-' << timestamp_day(records.timestamp[start]) << ' ' << timestamp_time(records.timestamp[start])
+					<< ',' << timestamp_year(records.timestamp[end]) << '-' << timestamp_month(records.timestamp[end]) << '-' << timestamp_day(records.timestamp[end]) << ' ' << timestamp_time(records.timestamp[end]);
+			}
+			else
+				ofs << ",,";
+			ofs << endl;
+		}
+	cout << "WRITTEN TO: " << file_name << endl;
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// *******************************************************************************FLOATS*****************************************************************************
+
+// Floating point kernel calls
+void floating_point_kernel_calls(size_t input_size, cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, vector<floating_point> air_temperatures, size_t local_size)
+{
+	// Half storage - only the half column is uploaded and reduced
+	moments half_result;
+	if (half_storage)
+	{
+		// Convert the temperatures to halfs - half the bytes of the floats
+		vector<cl_half> air_temperatures_half(input_elements);
+		for (size_t i = 0; i < input_elements; i++)
+			air_temperatures_half[i] = float_to_half(air_temperatures[i]);
+		size_t input_size_half = input_elements * sizeof(cl_half);
+
+		// Device - half input buffer
+		cl::Buffer buffer_input_half = acquire_buffer(context, input_size_half);
+		cl::Event event_write_half;
+		queue.enqueueWriteBuffer(buffer_input_half, CL_TRUE, 0, input_size_half, &air_temperatures_half[0], NULL, &event_write_half);
+		transfer_report("half input upload", event_write_half.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_write_half.getProfilingInfo<CL_PROFILING_COMMAND_START>(), (double)input_size_half, true);
+
+		// Reduce the half column
+		cout << "HALF STORAGE\t|| input [bytes]: " << input_size_half << "\t|| memory transfer [nano - seconds]: "
+			<< event_write_half.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_write_half.getProfilingInfo<CL_PROFILING_COMMAND_START>() << endl;
+		half_result = float_reduction(context, input_elements, queue, program, buffer_input_half, local_size, true);
+		release_buffer(buffer_input_half);
+
+		// The full precision column is only needed to validate the halfs
+		if (!validate_half) return;
+	}
+
+	// Device - input buffer
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+
+	// Copy temperatures arrays to and initialise other arrays on device memory
+	cl::Event event_write;
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &air_temperatures[0], NULL, &event_write);
+	transfer_report("input upload", event_write.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_write.getProfilingInfo<CL_PROFILING_COMMAND_START>(), (double)input_size, true);
+
+	// Reduction kernel calls
+	if (half_storage)
+		cout << "FULL PRECISION STORAGE\t|| input [bytes]: " << input_size << endl;
+	moments full_result = float_reduction(context, input_elements, queue, program, buffer_input, local_size);
+
+	// Return the input buffer to the pool
+	release_buffer(buffer_input);
+
+	// Validate the half storage against full precision
+	if (half_storage)
+	{
+		// Differences to the full precision results - halfs hold the tenths of the temperatures to within half of their spacing
+		floating_point tolerance = ldexp(1.0f, ilogb(max(fabs(full_result.max), fabs(full_result.min))) - 11);
+		floating_point differences[4] = { fabs(half_result.max - full_result.max), fabs(half_result.min - full_result.min),
+			fabs((floating_point)(half_result.sum - full_result.sum)) / full_result.count, fabs(sqrt((floating_point)(half_result.m2 / half_result.count)) - sqrt((floating_point)(full_result.m2 / full_result.count))) };
+		cout << "***********************************************************************************************************************************************" << endl;
+		cout << "HALF STORAGE AGAINST FULL PRECISION" << endl;
+		cout << "MAX difference: " << differences[0] << "\t|| MIN difference: " << differences[1] << "\t|| MEAN difference: " << differences[2] << "\t|| STANDARD DEVIATION difference: " << differences[3] << endl;
+		cout << "Tolerance - half of the spacing of the halfs at the extremes: " << tolerance << "\t|| "
+			<< (*max_element(differences, differences + 4) <= tolerance ? "VALIDATED" : "NOT VALIDATED") << endl;
+		cout << "***********************************************************************************************************************************************" << endl;
+	}
+}
+
+// Reduction floats - returns the moments of the temperatures
+// The reductions are queued as a graph of commands linked by events - max, min and sum run concurrently on an out of order queue,
+// the standard deviation waits on the sum for the mean and all results are read back once at the end
+// Half inputs are reduced by the half kernels, which widen to floats on load
+moments float_reduction(cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t local_size, bool half_input)
+{
+	// Kernels of the first pass - the partial results are always floats
+	string first_suffix = half_input ? "_half" : "";
+	size_t input_element_size = half_input ? sizeof(cl_half) : sizeof(floating_point);
+	moments result;
+	result.count = number_of_data_entries;
+
+	// Size in bytes of the results of all reductions
+	size_t results_size = 4 * sizeof(floating_point);
+	cl::Buffer buffer_results = acquire_buffer(context, results_size);
+
+	// Kernel intialisation from the cache - the kernels hold the neutral elements past the data entries so the input is shared unpadded
+	const string reduction_kernels[3] = { "reduction_max", "reduction_min", "reduction_sum" };
+	vector<tree_reduction> trees(4);
+	vector<cl::Event> wait_none;
+	for (size_t i = 0; i < 3; i++)
+	{
+		cl::Kernel &kernel_first = cached_kernel(program, reduction_kernels[i] + first_suffix);
+		kernel_first.setArg(0, buffer_input);
+		kernel_first.setArg(3, (integer)number_of_data_entries);
+		enqueue_float_tree_reduction(context, queue, program, input_elements, local_size, kernel_first, reduction_kernels[i], wait_none, trees[i]);
+	}
+
+	// The mean is computed on device from the result of the sum reduction - the first pass squares the differences from the mean, the partial results are summed
+	cl::Kernel &kernel_redux_std_dev = cached_kernel(program, "reduction_standard_deviation" + first_suffix);
+	kernel_redux_std_dev.setArg(0, buffer_input);
+	kernel_redux_std_dev.setArg(3, trees[2].buffer_partial[trees[2].current]);
+	kernel_redux_std_dev.setArg(4, (integer)number_of_data_entries);
+	vector<cl::Event> wait_std_dev = { trees[2].events.back() };
+	enqueue_float_tree_reduction(context, queue, program, input_elements, local_size, kernel_redux_std_dev, "reduction_sum", wait_std_dev, trees[3]);
+
+	// Gather the results on device behind their last launches
+	vector<cl::Event> events_gather(4);
+	for (size_t i = 0; i < trees.size(); i++)
+	{
+		vector<cl::Event> wait_gather = { trees[i].events.back() };
+		queue.enqueueCopyBuffer(trees[i].buffer_partial[trees[i].current], buffer_results, 0, i * sizeof(floating_point), sizeof(floating_point), &wait_gather, &events_gather[i]);
+	}
+
+	// Copy all results from device to host - the only read back, non blocking until the graph is flushed
+	vector<floating_point> results(4);
+	cl::Event event_results_transfer;
+	queue.enqueueReadBuffer(buffer_results, CL_FALSE, 0, results_size, &results[0], &events_gather, &event_results_transfer);
+	queue.flush();
+	event_results_transfer.wait();
+	cl_ulong transfer_time = event_results_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_results_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+
+	// Span of the graph - first kernel start to last kernel end - less than the sum of the kernels when they overlap
+	cl_ulong graph_start = ULLONG_MAX;
+	cl_ulong graph_end = 0;
+	size_t kernel_launches = 0;
+	for (tree_reduction &tree : trees)
+		for (cl::Event &event : tree.events)
+		{
+			graph_start = min(graph_start, (cl_ulong)event.getProfilingInfo<CL_PROFILING_COMMAND_START>());
+			graph_end = max(graph_end, (cl_ulong)event.getProfilingInfo<CL_PROFILING_COMMAND_END>());
+			kernel_launches++;
+		}
 
-	// Call all kernels in a sequence
-	cl::Event event_redux_max_profiling;
-	cl::Event event_redux_max_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_max, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_max_profiling);
+	// Calculate means and variance
+	result.max = results[0];
+	result.min = results[1];
+	result.sum = results[2];
+	result.m2 = results[3];
+	mean_float = results[2] / number_of_data_entries;
+	variance_float = results[3] / number_of_data_entries;
 
-	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_max, CL_TRUE, 0, output_size, &temperature_redux_max_result[0], NULL, &event_redux_max_transfer);
+	// Preffered size
+	prefferSize = cached_kernel(program, "reduction_max").getWorkGroupInfo<CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE>(device);
 
-	// Display the profiling event data for the kernel
-	execution_time = event_redux_max_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_max_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_max_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_max_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: "	<< execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time	<< endl;
-	cout << "MAX TEMPERATURE: "																			<< (float)temperature_redux_max_result[0] / 10.0f								<< endl;
+#pragma region REDUCTION MAX FLOATS
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "MAX REDUCTION FLOATS" << endl;
+	cl_ulong execution_time = report_float_tree_reduction(trees[0], local_size, input_element_size, 1);
+	cout << "MAX TEMPERATURE: "																														<< results[0]						<< endl;
 	cout << "***********************************************************************************************************************************************"							<< endl;
+#pragma endregion
 
-	// Preffered size
-	prefferSize = kernel_redux_max.getWorkGroupInfo<CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE>(device);
+#pragma region REDUCTION MIN FLOATS
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "MIN REDUCTION FLOATS" << endl;
+	execution_time += report_float_tree_reduction(trees[1], local_size, input_element_size, 1);
+	cout << "MIN TEMPERATURE: "																														<< results[1]						<< endl;
+	cout << "***********************************************************************************************************************************************"							<< endl;
 #pragma endregion
 
-#pragma region REDUCTION MIN INTS
-	// Host - output
-	vector<integer> temperature_redux_min_result(input_elements);
+#pragma region REDUCTION SUM FLOATS
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "MEAN REDUCTION FLOATS" << endl;
+	execution_time += report_float_tree_reduction(trees[2], local_size, input_element_size, 1);
+	cout << "MEAN TEMPERATURE: "																													<< mean_float			<< endl;
+	cout << "***********************************************************************************************************************************************"				<< endl;
+#pragma endregion
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_min(context, CL_MEM_READ_WRITE, output_size);
+#pragma region REDUCTION STANDARD DEVIATION FLOATS
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "STANDARD DEVIATION REDUCTION FLOATS" << endl;
+	execution_time += report_float_tree_reduction(trees[3], local_size, input_element_size, 3);
+	cout << "VARIANCE: "																															<< variance_float		<< endl;
+	cout << "STANDARD DEVIATION: "																													<< sqrt(variance_float) << endl;
+	cout << "***********************************************************************************************************************************************"				<< endl;
+#pragma endregion
 
-	// Display info
+	// Display the graph timings
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "FLOAT REDUCTION GRAPH" << endl;
+	cout << "Kernel launches: " << kernel_launches << " \t|| Graph span [nano-seconds]: " << graph_end - graph_start << "\t|| Sum of kernel executions [nano-seconds]: " << execution_time
+		<< "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+	transfer_report("read back", transfer_time, (double)results_size, false);
 	cout << "***********************************************************************************************************************************************" << endl;
-	cout << "MIN REDUCTION INTEGERS - ATOMIC METHOD" << endl;
 
-	// Kernel intialisation
-	cl::Kernel kernel_redux_min = cl::Kernel(program, "reduction_min_int");
-	kernel_redux_min.setArg(0, buffer_input);
-	kernel_redux_min.setArg(1, buffer_output_redux_min);
-	kernel_redux_min.setArg(2, cl::Local(local_size * sizeof(integer)));
+	// Return the buffers to the pool - the graph has completed
+	for (tree_reduction &tree : trees)
+	{
+		release_buffer(tree.buffer_partial[0]);
+		release_buffer(tree.buffer_partial[1]);
+	}
+	release_buffer(buffer_results);
 
-	// Call all kernels in a sequence
-	cl::Event event_redux_min_profiling;
-	cl::Event event_redux_min_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_min, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_min_profiling);
+	return result;
+}
 
-	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_min, CL_TRUE, 0, output_size, &temperature_redux_min_result[0], NULL, &event_redux_min_transfer);
+// Convert a float to a half - round to nearest even, out of range values become infinities and tiny values halfs subnormals
+cl_half float_to_half(floating_point value)
+{
+	// Bits of the float
+	cl_uint bits;
+	memcpy(&bits, &value, sizeof(bits));
+	cl_uint sign = (bits >> 16) & 0x8000;
+	cl_uint magnitude = bits & 0x7FFFFFFF;
+
+	// Infinity or not a number
+	if (magnitude >= 0x7F800000)
+		return (cl_half)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+
+	// Overflow to infinity - the largest half is 65504
+	if (magnitude >= 0x477FF000)
+		return (cl_half)(sign | 0x7C00);
+
+	// Subnormal half or zero - shift the significand with the implicit bit
+	if (magnitude < 0x38800000)
+	{
+		integer shift = 126 - (integer)(magnitude >> 23);
+		if (shift > 24) return (cl_half)sign;
+		cl_uint significand = (magnitude & 0x7FFFFF) | 0x800000;
+		cl_uint half_bits = significand >> shift;
+		cl_uint remainder = significand & ((1u << shift) - 1);
+		cl_uint halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half_bits & 1))) half_bits++;
+		return (cl_half)(sign | half_bits);
+	}
 
-	// Display the profiling event data for the kernel
-	execution_time = event_redux_min_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_min_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_min_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_min_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: "	<< execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
-	cout << "MIN TEMPERATURE: "																			<< (float)temperature_redux_min_result[0] / 10.0f								<< endl;
-	cout << "***********************************************************************************************************************************************"							<< endl;
-#pragma endregion
+	// Normal half - rebias the exponent and round the significand
+	cl_uint half_bits = ((magnitude - 0x38000000) >> 13);
+	cl_uint remainder = magnitude & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half_bits & 1))) half_bits++;
+	return (cl_half)(sign | half_bits);
+}
 
-#pragma region REDUCTION SUM INTS
-	// Host - output
-	vector<integer> temperature_redux_sum_result(input_elements);
+// Queue the reduction of a buffer of floats to a single value behind the wait list
+// The input and the arguments past the local memory of the first kernel are set by the caller - every pass holds the neutral element past its elements
+// Each pass waits on the one before, so the passes of different reductions can run concurrently on an out of order queue
+void enqueue_float_tree_reduction(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t input_elements, size_t local_size,
+	cl::Kernel &kernel_first, const string &partial_kernel, const vector<cl::Event> &wait_list, tree_reduction &tree)
+{
+	// Number of partial results - one per work group - and their size in bytes padded up to the work group size
+	size_t partial_elements = input_elements / local_size;
+	size_t partial_size = round_up(partial_elements, local_size) * sizeof(floating_point);
+
+	// Device - two pooled buffers of partial results sized to the group count
+	// Each pass reads one and writes the other so no pass reads the values another work group is writing
+	tree.buffer_partial[0] = acquire_buffer(context, partial_size);
+	tree.buffer_partial[1] = acquire_buffer(context, partial_size);
+	tree.current = 0;
+
+	// First pass - the input reduced to one partial result per work group
+	tree.events.assign(1, cl::Event());
+	tree.launch_elements.assign(1, input_elements);
+	kernel_first.setArg(1, tree.buffer_partial[tree.current]);
+	kernel_first.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+	queue.enqueueNDRangeKernel(kernel_first, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), &wait_list, &tree.events[0]);
+
+	// Reduce the partial results until one is left
+	cl::Kernel &kernel_partial = cached_kernel(program, partial_kernel);
+	while (partial_elements > 1)
+	{
+		// Launch over the partial results padded up to the work group size
+		size_t padded_elements = round_up(partial_elements, local_size);
+		kernel_partial.setArg(0, tree.buffer_partial[tree.current]);
+		kernel_partial.setArg(1, tree.buffer_partial[1 - tree.current]);
+		kernel_partial.setArg(2, cl::Local(local_size * sizeof(floating_point)));
+		kernel_partial.setArg(3, (integer)partial_elements);
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_sum(context, CL_MEM_READ_WRITE, output_size);
+		// Call all kernels in a sequence
+		vector<cl::Event> wait_partial = { tree.events.back() };
+		tree.events.push_back(cl::Event());
+		tree.launch_elements.push_back(padded_elements);
+		queue.enqueueNDRangeKernel(kernel_partial, cl::NullRange, cl::NDRange(padded_elements), cl::NDRange(local_size), &wait_partial, &tree.events.back());
+		partial_elements = padded_elements / local_size;
+		tree.current = 1 - tree.current;
+	}
+}
 
-	// Display info
-	cout << "***********************************************************************************************************************************************" << endl;
-	cout << "MEAN REDUCTION INTEGERS - ATOMIC METHOD" << endl;
+// Display the launches of a completed tree reduction - returns the sum of their execution times
+// The bytes of an input element and the operations per element of the first pass feed the roofline report
+cl_ulong report_float_tree_reduction(const tree_reduction &tree, size_t local_size, size_t input_element_size, integer first_operations)
+{
+	// Display the profiling event data for the kernels
+	cl_ulong total_execution_time = 0;
+	int kernel_launches = 0;
+	for (const cl::Event &event : tree.events)
+	{
+		cl_ulong execution_time = event.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+		total_execution_time += execution_time;
+		kernel_launches++;
+		cout << "Kernel luanch: " << kernel_launches << "\t\t\t|| Time for kernel " << kernel_launches << " execution [nano-seconds]: " << execution_time << endl;
 
-	// Kernel intialisation
-	cl::Kernel kernel_redux_sum = cl::Kernel(program, "reduction_sum_int");
+		// Each launch reads its elements and writes one partial result per work group
+		size_t elements = tree.launch_elements[kernel_launches - 1];
+		size_t element_size = kernel_launches == 1 ? input_element_size : sizeof(floating_point);
+		roofline_report("kernel " + to_string(kernel_launches), execution_time, (double)elements * element_size + (double)(elements / local_size) * sizeof(floating_point),
+			(double)elements * (kernel_launches == 1 ? first_operations : 1));
+	}
+	cout << "Total reduction kernel luanches: " << kernel_launches << "\t|| Total time for " << kernel_launches << " executions [nano-seconds]: " << total_execution_time << endl;
+
+	return total_execution_time;
+}
+
+// *****************************************************************************INTEGERS*****************************************************************************
+
+// Integer kernel calls
+void integer_kernel_calls(size_t input_size, cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, vector<fixed_point> air_temperatures, size_t local_size)
+{
+	// Device - input buffer
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+
+	// Copy temperatures arrays to and initialise other arrays on device memory
+	cl::Event event_write;
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &air_temperatures[0], NULL, &event_write);
+	transfer_report("input upload", event_write.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_write.getProfilingInfo<CL_PROFILING_COMMAND_START>(), (double)input_size, true);
+
+	// Reduction kernel calls
+	integer_reduction(context, input_elements, queue, program, buffer_input, local_size);
+
+	// Return the input buffer to the pool
+	release_buffer(buffer_input);
+}
+
+// Reduction integer value
+// The reductions are queued as a graph of commands linked by events - max, min and sum run concurrently on an out of order queue,
+// the standard deviation waits on the sum and all results are read back once at the end
+void integer_reduction(cl::Context &context, size_t input_elements, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, size_t local_size)
+{
+	// Size in bytes - one output per reduction and the results of all reductions
+	size_t output_size = sizeof(integer);
+	size_t results_size = 4 * sizeof(integer);
+
+	// Device - pooled output buffers
+	cl::Buffer buffer_output_redux_max = acquire_buffer(context, output_size);
+	cl::Buffer buffer_output_redux_min = acquire_buffer(context, output_size);
+	cl::Buffer buffer_output_redux_sum = acquire_buffer(context, output_size);
+	cl::Buffer buffer_output_redux_std_dev = acquire_buffer(context, output_size);
+	cl::Buffer buffer_results = acquire_buffer(context, results_size);
+
+	// Fill the outputs with the neutral elements of the reductions
+	vector<cl::Event> events_fill(4);
+	queue.enqueueFillBuffer(buffer_output_redux_max, INT_MIN, 0, output_size, NULL, &events_fill[0]);
+	queue.enqueueFillBuffer(buffer_output_redux_min, INT_MAX, 0, output_size, NULL, &events_fill[1]);
+	queue.enqueueFillBuffer(buffer_output_redux_sum, 0, 0, output_size, NULL, &events_fill[2]);
+	queue.enqueueFillBuffer(buffer_output_redux_std_dev, 0, 0, output_size, NULL, &events_fill[3]);
+
+	// Kernel intialisation from the cache - the kernels hold the neutral elements past the data entries so the input is shared unpadded
+	cl::Kernel &kernel_redux_max = cached_kernel(program, "reduction_max_int");
+	kernel_redux_max.setArg(0, buffer_input);
+	kernel_redux_max.setArg(1, buffer_output_redux_max);
+	kernel_redux_max.setArg(2, cl::Local(local_size * sizeof(integer)));
+	kernel_redux_max.setArg(3, (integer)number_of_data_entries);
+
+	cl::Kernel &kernel_redux_min = cached_kernel(program, "reduction_min_int");
+	kernel_redux_min.setArg(0, buffer_input);
+	kernel_redux_min.setArg(1, buffer_output_redux_min);
+	kernel_redux_min.setArg(2, cl::Local(local_size * sizeof(integer)));
+	kernel_redux_min.setArg(3, (integer)number_of_data_entries);
+
+	cl::Kernel &kernel_redux_sum = cached_kernel(program, "reduction_sum_int");
 	kernel_redux_sum.setArg(0, buffer_input);
 	kernel_redux_sum.setArg(1, buffer_output_redux_sum);
 	kernel_redux_sum.setArg(2, cl::Local(local_size * sizeof(integer)));
+	kernel_redux_sum.setArg(3, (integer)number_of_data_entries);
 
-	// Call all kernels in a sequence
-	cl::Event event_redux_sum_profiling;
-	cl::Event event_redux_sum_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_sum, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_sum_profiling);
+	// The mean is computed on device from the output of the sum reduction
+	cl::Kernel &kernel_redux_std_dev = cached_kernel(program, "reduction_standard_deviation_int");
+	kernel_redux_std_dev.setArg(0, buffer_input);
+	kernel_redux_std_dev.setArg(1, buffer_output_redux_std_dev);
+	kernel_redux_std_dev.setArg(2, cl::Local(local_size * sizeof(integer)));
+	kernel_redux_std_dev.setArg(3, buffer_output_redux_sum);
+	kernel_redux_std_dev.setArg(4, (integer)number_of_data_entries);
+
+	// Dependencies of each kernel - its output filled and, for the standard deviation, the sum
+	vector<cl::Event> wait_max = { events_fill[0] };
+	vector<cl::Event> wait_min = { events_fill[1] };
+	vector<cl::Event> wait_sum = { events_fill[2] };
+	vector<cl::Event> events_redux(4);
+	queue.enqueueNDRangeKernel(kernel_redux_max, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), &wait_max, &events_redux[0]);
+	queue.enqueueNDRangeKernel(kernel_redux_min, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), &wait_min, &events_redux[1]);
+	queue.enqueueNDRangeKernel(kernel_redux_sum, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), &wait_sum, &events_redux[2]);
+	vector<cl::Event> wait_std_dev = { events_fill[3], events_redux[2] };
+	queue.enqueueNDRangeKernel(kernel_redux_std_dev, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), &wait_std_dev, &events_redux[3]);
+
+	// Gather the outputs on device behind their kernels
+	vector<cl::Event> events_gather(4);
+	vector<cl::Buffer*> outputs = { &buffer_output_redux_max, &buffer_output_redux_min, &buffer_output_redux_sum, &buffer_output_redux_std_dev };
+	for (size_t i = 0; i < outputs.size(); i++)
+	{
+		vector<cl::Event> wait_gather = { events_redux[i] };
+		queue.enqueueCopyBuffer(*outputs[i], buffer_results, 0, i * sizeof(integer), output_size, &wait_gather, &events_gather[i]);
+	}
 
-	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_sum, CL_TRUE, 0, output_size, &temperature_redux_sum_result[0], NULL, &event_redux_sum_transfer);
+	// Copy all results from device to host - the only read back, non blocking until the graph is flushed
+	vector<integer> results(4);
+	cl::Event event_results_transfer;
+	queue.enqueueReadBuffer(buffer_results, CL_FALSE, 0, results_size, &results[0], &events_gather, &event_results_transfer);
+	queue.flush();
+	event_results_transfer.wait();
 
-	// Display the profiling event data for the kernel
-	execution_time = event_redux_sum_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_sum_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_sum_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_sum_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	// Assign an ulong for holding the execution time of kernels
+	cl_ulong transfer_time = event_results_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_results_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	vector<cl_ulong> execution_time(4);
+	for (size_t i = 0; i < events_redux.size(); i++)
+		execution_time[i] = events_redux[i].getProfilingInfo<CL_PROFILING_COMMAND_END>() - events_redux[i].getProfilingInfo<CL_PROFILING_COMMAND_START>();
+
+	// Span of the graph - first kernel start to last kernel end - less than the sum of the kernels when they overlap
+	cl_ulong graph_start = ULLONG_MAX;
+	cl_ulong graph_end = 0;
+	for (cl::Event &event : events_redux)
+	{
+		graph_start = min(graph_start, (cl_ulong)event.getProfilingInfo<CL_PROFILING_COMMAND_START>());
+		graph_end = max(graph_end, (cl_ulong)event.getProfilingInfo<CL_PROFILING_COMMAND_END>());
+	}
+
+	// Return the output buffers to the pool - the graph has completed
+	release_buffer(buffer_output_redux_max);
+	release_buffer(buffer_output_redux_min);
+	release_buffer(buffer_output_redux_sum);
+	release_buffer(buffer_output_redux_std_dev);
+	release_buffer(buffer_results);
 
-	// Calculate means
-	mean_float = (temperature_redux_sum_result[0] / 10.0f) / number_of_data_entries;
+	// Calculate means and variance
+	mean_float = (results[2] / 10.0f) / number_of_data_entries;
 	mean_int = (int)(mean_float * 10.0f);
-	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
-	cout << "MEAN TEMPERATURE: " << mean_float << endl;
+	variance_float = (results[3] / 10.0f) / number_of_data_entries;
+
+#pragma region REDUCTION MAX INTS
+	// Display info
 	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "MAX REDUCTION INTEGERS - ATOMIC METHOD" << endl;
+	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: "	<< execution_time[0]												<< endl;
+	cout << "MAX TEMPERATURE: "																			<< (float)results[0] / 10.0f										<< endl;
+	cout << "***********************************************************************************************************************************************"							<< endl;
 #pragma endregion
 
-#pragma region REDUCTION STANDARD DEVIATION INTS
-	// Host - output
-	vector<integer> temperature_redux_std_dev_result(input_elements);
+#pragma region REDUCTION MIN INTS
+	// Display info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "MIN REDUCTION INTEGERS - ATOMIC METHOD" << endl;
+	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: "	<< execution_time[1]												<< endl;
+	cout << "MIN TEMPERATURE: "																			<< (float)results[1] / 10.0f										<< endl;
+	cout << "***********************************************************************************************************************************************"							<< endl;
+#pragma endregion
 
-	// Device - output buffers
-	cl::Buffer buffer_output_redux_std_dev(context, CL_MEM_READ_WRITE, output_size);
+#pragma region REDUCTION SUM INTS
+	// Display info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "MEAN REDUCTION INTEGERS - ATOMIC METHOD" << endl;
+	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: "	<< execution_time[2]												<< endl;
+	cout << "MEAN TEMPERATURE: "																		<< mean_float														<< endl;
+	cout << "***********************************************************************************************************************************************"							<< endl;
+#pragma endregion
 
+#pragma region REDUCTION STANDARD DEVIATION INTS
 	// Display info
 	cout << "***********************************************************************************************************************************************" << endl;
 	cout << "STANDARD DEVIATION REDUCTION INTEGERS - ATOMIC METHOD" << endl;
+	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: "	<< execution_time[3]												<< endl;
+	cout << "VARIANCE: "																				<< variance_float													<< endl;
+	cout << "STANDARD DEVIATION: "																		<< sqrt(variance_float)												<< endl;
+	cout << "***********************************************************************************************************************************************"							<< endl;
+#pragma endregion
 
-	// Kernel intialisation
-	cl::Kernel kernel_redux_std_dev = cl::Kernel(program, "reduction_standard_deviation_int");
-	kernel_redux_std_dev.setArg(0, buffer_input);
-	kernel_redux_std_dev.setArg(1, buffer_output_redux_std_dev);
-	kernel_redux_std_dev.setArg(2, cl::Local(local_size * sizeof(integer)));
-	kernel_redux_std_dev.setArg(3, mean_int);
+	// Display the graph timings
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "INTEGER REDUCTION GRAPH" << endl;
+	cout << "Kernel launches: 4 \t|| Graph span [nano-seconds]: " << graph_end - graph_start << "\t|| Sum of kernel executions [nano-seconds]: " << accumulate(execution_time.begin(), execution_time.end(), (cl_ulong)0)
+		<< "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+
+	// Each kernel reads every short and merges one int per work group - the standard deviation subtracts, squares and adds
+	const char* kernel_names[4] = { "max", "min", "sum", "standard deviation" };
+	for (size_t i = 0; i < 4; i++)
+		roofline_report(kernel_names[i], execution_time[i], (double)input_elements * sizeof(fixed_point) + (double)(input_elements / local_size) * sizeof(integer),
+			(double)input_elements * (i == 3 ? 3 : 1));
+	transfer_report("read back", transfer_time, (double)results_size, false);
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// *******************************************************************************FILTERS****************************************************************************
+
+// Select the records matching the query filter on device and compact their temperatures
+size_t filter_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size, cl::Buffer &buffer_selected, cl::Buffer &buffer_selected_int)
+{
+	// Number of records and the padded number of work items
+	size_t records_count = records.temperature.size();
+	size_t input_elements = round_up(records_count, local_size);
+
+	// Look up the station code of the filter - an unknown station selects nothing
+	if (!query_filter.station_name.empty())
+	{
+		query_filter.station = find(station_names.begin(), station_names.end(), query_filter.station_name) - station_names.begin();
+		if (query_filter.station == station_names.size()) return 0;
+	}
+
+	// Size in bytes
+	size_t station_size = records_count * sizeof(cl_uchar);
+	size_t timestamp_size = records_count * sizeof(cl_uint);
+	size_t input_size = records_count * sizeof(fixed_point);
+
+	// Device - pooled column buffers
+	cl::Buffer buffer_station = acquire_buffer(context, station_size);
+	cl::Buffer buffer_timestamp = acquire_buffer(context, timestamp_size);
+	cl::Buffer buffer_temperature = acquire_buffer(context, input_size);
+
+	// Device - pooled compacted output buffers - padded to the work group size for the reductions, returned to the pool by the caller
+	buffer_selected = acquire_buffer(context, input_elements * sizeof(floating_point));
+	buffer_selected_int = acquire_buffer(context, input_elements * sizeof(fixed_point));
+	cl::Buffer buffer_selected_count = acquire_buffer(context, sizeof(integer));
+
+	// Copy the columns to device memory and zero the selected count
+	vector<cl::Event> events_upload(3);
+	queue.enqueueWriteBuffer(buffer_station, CL_TRUE, 0, station_size, &records.station[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_timestamp, CL_TRUE, 0, timestamp_size, &records.timestamp[0], NULL, &events_upload[1]);
+	queue.enqueueWriteBuffer(buffer_temperature, CL_TRUE, 0, input_size, &records.temperature[0], NULL, &events_upload[2]);
+	queue.enqueueFillBuffer(buffer_selected_count, 0, 0, sizeof(integer));
+
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "FILTER AND COMPACTION" << endl;
+
+	// Kernel intialisation from the cache
+	cl::Kernel &kernel_filter = cached_kernel(program, "filter_records");
+	kernel_filter.setArg(0, buffer_station);
+	kernel_filter.setArg(1, buffer_timestamp);
+	kernel_filter.setArg(2, buffer_temperature);
+	kernel_filter.setArg(3, buffer_selected);
+	kernel_filter.setArg(4, buffer_selected_int);
+	kernel_filter.setArg(5, buffer_selected_count);
+	kernel_filter.setArg(6, cl::Local(local_size * sizeof(integer)));
+	kernel_filter.setArg(7, query_filter.station == SIZE_MAX ? -1 : (integer)query_filter.station);
+	kernel_filter.setArg(8, query_filter.year_range);
+	kernel_filter.setArg(9, query_filter.month_range);
+	kernel_filter.setArg(10, query_filter.day_range);
+	kernel_filter.setArg(11, query_filter.time_range);
+	kernel_filter.setArg(12, query_filter.temperature_range);
+	kernel_filter.setArg(13, (integer)records_count);
+
+	// Call the kernel - a single pass over the columns
+	cl::Event event_filter_profiling;
+	cl::Event event_filter_transfer;
+	queue.enqueueNDRangeKernel(kernel_filter, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_filter_profiling);
+
+	// Copy the selected count from device to host
+	integer selected_count = 0;
+	queue.enqueueReadBuffer(buffer_selected_count, CL_TRUE, 0, sizeof(integer), &selected_count, NULL, &event_filter_transfer);
+
+	// Return the column buffers to the pool - the filter has completed
+	release_buffer(buffer_station);
+	release_buffer(buffer_timestamp);
+	release_buffer(buffer_temperature);
+	release_buffer(buffer_selected_count);
+
+	// Display the profiling event data for the kernel
+	cl_ulong execution_time = event_filter_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_filter_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cl_ulong transfer_time = event_filter_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_filter_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "Total filter kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+	cout << "SELECTED RECORDS: " << selected_count << " OF " << records_count << endl;
+
+	// Every record is read and the selected ones are written as a float and a short - a division and twelve range comparisons per record
+	roofline_report("filter", execution_time, (double)(station_size + timestamp_size + input_size) + (double)selected_count * (sizeof(floating_point) + sizeof(fixed_point)), (double)records_count * 13);
+	transfer_report("records upload", profiled_time(events_upload), (double)(station_size + timestamp_size + input_size), true);
+	transfer_report("read back", transfer_time, sizeof(integer), false);
+	cout << "***********************************************************************************************************************************************" << endl;
+
+	// Return the number of selected records
+	return selected_count;
+}
+
+// Records matching the query filter - all columns, in the order of the file
+// The same query as the filter kernel, for the statistics that report the records and not only their temperatures
+record_columns select_records(const record_columns &records)
+{
+	record_columns selected;
+	for (size_t i = 0; i < records.temperature.size(); i++)
+	{
+		// Decode the record and evaluate the query on it
+		cl_uint timestamp = records.timestamp[i];
+		integer year = timestamp_year(timestamp), month = timestamp_month(timestamp), day = timestamp_day(timestamp), time = timestamp_time(timestamp);
+		floating_point value = records.temperature[i] / 10.0f;
+		if ((query_filter.station == SIZE_MAX || records.station[i] == query_filter.station) &&
+			(year >= query_filter.year_range.s[0] && year <= query_filter.year_range.s[1]) &&
+			(month >= query_filter.month_range.s[0] && month <= query_filter.month_range.s[1]) &&
+			(day >= query_filter.day_range.s[0] && day <= query_filter.day_range.s[1]) &&
+			(time >= query_filter.time_range.s[0] && time <= query_filter.time_range.s[1]) &&
+			(value >= query_filter.temperature_range.s[0] && value <= query_filter.temperature_range.s[1]))
+		{
+			selected.station.push_back(records.station[i]);
+			selected.timestamp.push_back(timestamp);
+			selected.temperature.push_back(records.temperature[i]);
+		}
+	}
+
+	return selected;
+}
+
+// ********************************************************************************SCANS*****************************************************************************
+
+// Inclusive or exclusive scan of a buffer of any length - returns the kernel execution time
+// All levels are queued without blocking, the scan waits once for its last launch before the pooled block sums are returned
+template <typename T>
+cl_ulong parallel_scan(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, cl::Buffer &buffer_output, size_t elements, size_t local_size, bool inclusive, const string &type_name)
+{
+	// Queue every level of the scan
+	vector<cl::Event> events_profiling;
+	vector<cl::Buffer> block_buffers;
+	enqueue_scan<T>(context, queue, program, buffer_input, buffer_output, elements, local_size, inclusive, type_name, events_profiling, block_buffers);
+	events_profiling.back().wait();
+
+	// Return the block sums to the pool
+	for (cl::Buffer &buffer : block_buffers)
+		release_buffer(buffer);
+
+	// Return the total execution time
+	cl_ulong execution_time = 0;
+	for (cl::Event &event : events_profiling)
+		execution_time += event.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	return execution_time;
+}
+
+// Queue one level of the scan - each work group scans a block of two elements per work item, the block sums are scanned recursively and added to their blocks
+// Every launch waits on the launch before it so the scan is ordered on an out of order queue as well
+template <typename T>
+void enqueue_scan(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, cl::Buffer &buffer_input, cl::Buffer &buffer_output, size_t elements, size_t local_size, bool inclusive,
+	const string &type_name, vector<cl::Event> &events_profiling, vector<cl::Buffer> &block_buffers)
+{
+	// Number of blocks
+	size_t block_size = local_size * 2;
+	size_t nr_blocks = round_up(elements, block_size) / block_size;
+
+	// Device - pooled block sums
+	cl::Buffer buffer_block_sums = acquire_buffer(context, nr_blocks * sizeof(T));
+	block_buffers.push_back(buffer_block_sums);
+
+	// Kernel intialisation from the cache - the arguments are captured when the launch is queued
+	cl::Kernel &kernel_scan = cached_kernel(program, "scan_blelloch_" + type_name);
+	kernel_scan.setArg(0, buffer_input);
+	kernel_scan.setArg(1, buffer_output);
+	kernel_scan.setArg(2, buffer_block_sums);
+	kernel_scan.setArg(3, cl::Local(block_size * sizeof(T)));
+	kernel_scan.setArg(4, (integer)elements);
+	kernel_scan.setArg(5, (integer)inclusive);
+
+	// Scan each block
+	vector<cl::Event> wait_list;
+	if (!events_profiling.empty()) wait_list.push_back(events_profiling.back());
+	events_profiling.push_back(cl::Event());
+	queue.enqueueNDRangeKernel(kernel_scan, cl::NullRange, cl::NDRange(nr_blocks * local_size), cl::NDRange(local_size), wait_list.empty() ? NULL : &wait_list, &events_profiling.back());
+
+	// A single block is already scanned
+	if (nr_blocks == 1) return;
+
+	// Exclusive scan of the block sums gives the offset of each block
+	cl::Buffer buffer_block_offsets = acquire_buffer(context, nr_blocks * sizeof(T));
+	block_buffers.push_back(buffer_block_offsets);
+	enqueue_scan<T>(context, queue, program, buffer_block_sums, buffer_block_offsets, nr_blocks, local_size, false, type_name, events_profiling, block_buffers);
+
+	// Kernel intialisation from the cache
+	cl::Kernel &kernel_add = cached_kernel(program, "scan_add_block_sums_" + type_name);
+	kernel_add.setArg(0, buffer_output);
+	kernel_add.setArg(1, buffer_block_offsets);
+	kernel_add.setArg(2, (integer)elements);
+
+	// Add the block offsets
+	wait_list.assign(1, events_profiling.back());
+	events_profiling.push_back(cl::Event());
+	queue.enqueueNDRangeKernel(kernel_add, cl::NullRange, cl::NDRange(nr_blocks * local_size), cl::NDRange(local_size), &wait_list, &events_profiling.back());
+}
+
+// Benchmark the device scan against the host scan
+template <typename T>
+void scan_benchmark(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, vector<T> &input, size_t local_size, const string &type_name)
+{
+	// Size in bytes
+	size_t elements = input.size();
+	size_t input_size = elements * sizeof(T);
+
+	// Host - scan
+	vector<T> host_result(elements);
+	hi_res_time_point start_of_host_scan = hi_res_clock::now();
+	inclusive_scan(input.begin(), input.end(), host_result.begin());
+	auto host_time = chrono::duration_cast<chrono::nanoseconds>(hi_res_clock::now() - start_of_host_scan).count();
+
+	// Device - pooled input and output buffers
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+	cl::Buffer buffer_output = acquire_buffer(context, input_size);
+	cl::Event event_write;
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &input[0], NULL, &event_write);
+
+	// Device - scan
+	cl_ulong execution_time = parallel_scan<T>(context, queue, program, buffer_input, buffer_output, elements, local_size, true, type_name);
+
+	// Copy the result from device to host
+	vector<T> device_result(elements);
+	cl::Event event_read;
+	queue.enqueueReadBuffer(buffer_output, CL_TRUE, 0, input_size, &device_result[0], NULL, &event_read);
+
+	// Return the buffers to the pool
+	release_buffer(buffer_input);
+	release_buffer(buffer_output);
+
+	// Largest difference to the host scan - relative to the host value
+	double max_error = 0.0;
+	for (size_t i = 0; i < elements; i++)
+		max_error = max(max_error, fabs((double)device_result[i] - (double)host_result[i]) / max(1.0, fabs((double)host_result[i])));
+
+	// Bandwidth - every element read and written once - bytes per nano-second is GB/s
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "INCLUSIVE SCAN " << type_name << endl;
+	cout << "Device scan [nano-seconds]: " << execution_time << "\t|| bandwidth [GB/s]: " << (2.0 * input_size) / execution_time << endl;
+	cout << "Host scan [nano-seconds]: " << host_time << "\t|| bandwidth [GB/s]: " << (2.0 * input_size) / host_time << endl;
+	cout << "Largest relative difference to the host scan: " << max_error << endl;
+
+	// The block scans add twice per element - up and down the tree
+	roofline_report("scan " + type_name, execution_time, 2.0 * input_size, 2.0 * elements);
+	transfer_report("input upload", event_write.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_write.getProfilingInfo<CL_PROFILING_COMMAND_START>(), (double)input_size, true);
+	transfer_report("read back", event_read.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_read.getProfilingInfo<CL_PROFILING_COMMAND_START>(), (double)input_size, false);
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// ***************************************************************************ROLLING WINDOWS************************************************************************
+
+// Rolling mean, standard deviation, min and max per station - written to a csv file
+// Records must be ordered by station and time, the window is the current reading and the readings before it at the same station
+void rolling_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t window, size_t local_size)
+{
+	// Number of records and the padded number of work items
+	size_t records_count = records.temperature.size();
+	size_t input_elements = round_up(records_count, local_size);
+
+	// First record of the station of each record and the fixed point temperatures - sums and squares as longs so the prefix sums are exact
+	vector<integer> segment_start(records_count);
+	vector<cl_long> temperatures_long(records_count);
+	vector<cl_long> temperatures_squares(records_count);
+	for (size_t i = 0; i < records_count; i++)
+	{
+		segment_start[i] = (i && records.station[i] == records.station[i - 1]) ? segment_start[i - 1] : (integer)i;
+		temperatures_long[i] = records.temperature[i];
+		temperatures_squares[i] = (cl_long)records.temperature[i] * records.temperature[i];
+	}
+
+	// First record of the blocks of each work group - blocks of the window length restart at the first record of each station
+	// A work group scans as many whole blocks as fit in it, or a single block longer than the work group
+	size_t blocks_per_group = max(local_size / window, (size_t)1);
+	size_t blocks = 0;
+	vector<integer> group_first;
+	for (size_t i = 0; i < records_count; i++)
+		if ((i - segment_start[i]) % window == 0 && blocks++ % blocks_per_group == 0)
+			group_first.push_back((integer)i);
+	group_first.push_back((integer)records_count);
+	size_t groups = group_first.size() - 1;
+
+	// Size in bytes
+	size_t group_first_size = group_first.size() * sizeof(integer);
+	size_t input_size = records_count * sizeof(fixed_point);
+	size_t column_size = records_count * sizeof(integer);
+	size_t long_size = records_count * sizeof(cl_long);
+	size_t output_size = records_count * 4 * sizeof(floating_point);
+
+	// Device - pooled input buffers
+	cl::Buffer buffer_group_first = acquire_buffer(context, group_first_size);
+	cl::Buffer buffer_segment_start = acquire_buffer(context, column_size);
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+	cl::Buffer buffer_input_long = acquire_buffer(context, long_size);
+	cl::Buffer buffer_input_squares = acquire_buffer(context, long_size);
+
+	// Device - pooled prefix sums, block extremes and output buffers
+	cl::Buffer buffer_prefix_sum = acquire_buffer(context, long_size);
+	cl::Buffer buffer_prefix_sum_squares = acquire_buffer(context, long_size);
+	cl::Buffer buffer_prefix_max = acquire_buffer(context, column_size);
+	cl::Buffer buffer_suffix_max = acquire_buffer(context, column_size);
+	cl::Buffer buffer_prefix_min = acquire_buffer(context, column_size);
+	cl::Buffer buffer_suffix_min = acquire_buffer(context, column_size);
+	cl::Buffer buffer_output = acquire_buffer(context, output_size);
+
+	// Copy the columns to device memory
+	vector<cl::Event> events_upload(5);
+	queue.enqueueWriteBuffer(buffer_group_first, CL_TRUE, 0, group_first_size, &group_first[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_segment_start, CL_TRUE, 0, column_size, &segment_start[0], NULL, &events_upload[1]);
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &records.temperature[0], NULL, &events_upload[2]);
+	queue.enqueueWriteBuffer(buffer_input_long, CL_TRUE, 0, long_size, &temperatures_long[0], NULL, &events_upload[3]);
+	queue.enqueueWriteBuffer(buffer_input_squares, CL_TRUE, 0, long_size, &temperatures_squares[0], NULL, &events_upload[4]);
+
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << "ROLLING WINDOW OF " << window << " READINGS" << endl;
+
+	// Prefix sums of the temperatures and their squares
+	cl_ulong scan_time = parallel_scan<cl_long>(context, queue, program, buffer_input_long, buffer_prefix_sum, records_count, local_size, true, "long");
+	scan_time += parallel_scan<cl_long>(context, queue, program, buffer_input_squares, buffer_prefix_sum_squares, records_count, local_size, true, "long");
+	cl_ulong execution_time = scan_time;
+
+	// Kernel intialisation from the cache
+	cl::Kernel &kernel_blocks = cached_kernel(program, "rolling_extremes_blocks");
+	kernel_blocks.setArg(0, buffer_group_first);
+	kernel_blocks.setArg(1, buffer_segment_start);
+	kernel_blocks.setArg(2, buffer_input);
+	kernel_blocks.setArg(3, buffer_prefix_max);
+	kernel_blocks.setArg(4, buffer_suffix_max);
+	kernel_blocks.setArg(5, buffer_prefix_min);
+	kernel_blocks.setArg(6, buffer_suffix_min);
+	kernel_blocks.setArg(7, cl::Local(local_size * sizeof(integer)));
+	kernel_blocks.setArg(8, cl::Local(local_size * sizeof(integer)));
+	kernel_blocks.setArg(9, cl::Local(local_size * sizeof(integer)));
+	kernel_blocks.setArg(10, (integer)window);
+	kernel_blocks.setArg(11, (integer)records_count);
+
+	cl::Kernel &kernel_statistics = cached_kernel(program, "rolling_statistics");
+	kernel_statistics.setArg(0, buffer_segment_start);
+	kernel_statistics.setArg(1, buffer_prefix_sum);
+	kernel_statistics.setArg(2, buffer_prefix_sum_squares);
+	kernel_statistics.setArg(3, buffer_prefix_max);
+	kernel_statistics.setArg(4, buffer_suffix_max);
+	kernel_statistics.setArg(5, buffer_prefix_min);
+	kernel_statistics.setArg(6, buffer_suffix_min);
+	kernel_statistics.setArg(7, buffer_output);
+	kernel_statistics.setArg(8, (integer)window);
+	kernel_statistics.setArg(9, (integer)records_count);
 
 	// Call all kernels in a sequence
-	cl::Event event_redux_std_dev_profiling;
-	cl::Event event_redux_std_dev_transfer;
-	queue.enqueueNDRangeKernel(kernel_redux_std_dev, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_redux_std_dev_profiling);
+	cl::Event event_blocks_profiling;
+	cl::Event event_statistics_profiling;
+	cl::Event event_rolling_transfer;
+	queue.enqueueNDRangeKernel(kernel_blocks, cl::NullRange, cl::NDRange(groups * local_size), cl::NDRange(local_size), NULL, &event_blocks_profiling);
+	queue.enqueueNDRangeKernel(kernel_statistics, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_statistics_profiling);
+
+	// Copy the result from device to host - mean, standard deviation, min and max of each record
+	vector<floating_point> rolling_result(records_count * 4);
+	queue.enqueueReadBuffer(buffer_output, CL_TRUE, 0, output_size, &rolling_result[0], NULL, &event_rolling_transfer);
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_group_first, &buffer_segment_start, &buffer_input, &buffer_input_long, &buffer_input_squares, &buffer_prefix_sum, &buffer_prefix_sum_squares,
+		&buffer_prefix_max, &buffer_suffix_max, &buffer_prefix_min, &buffer_suffix_min, &buffer_output })
+		release_buffer(*buffer);
+
+	// Display the profiling event data for the kernels
+	execution_time += event_blocks_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_blocks_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	execution_time += event_statistics_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_statistics_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cl_ulong transfer_time = event_rolling_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_rolling_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "Total time for all executions [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time << endl;
+
+	// The prefix scans read and write the longs of the temperatures and their squares, adding twice per element
+	// The block scans read the station start and temperature of a record and write its four block extremes - two comparisons each way
+	// The statistics read the station start, two pairs of prefix sums and four block extremes of a record and write its four statistics
+	roofline_report("rolling blocks", event_blocks_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_blocks_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>(),
+		(double)records_count * (sizeof(integer) + sizeof(fixed_point) + 4 * sizeof(integer)), (double)records_count * 4);
+	roofline_report("rolling statistics", event_statistics_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_statistics_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>(),
+		(double)records_count * (sizeof(integer) + 4 * sizeof(cl_long) + 4 * sizeof(integer) + 4 * sizeof(floating_point)), (double)records_count * 12);
+	roofline_report("rolling prefix sums", scan_time, 4.0 * long_size, 4.0 * records_count);
+	transfer_report("columns upload", profiled_time(events_upload), (double)(group_first_size + column_size + input_size + 2 * long_size), true);
+	transfer_report("read back", transfer_time, (double)output_size, false);
+
+	// Write the time series to a csv file
+	string output_file = "rolling_" + to_string(window) + ".csv";
+	ofstream ofs(output_file);
+	ofs << "station,year,month,day,time,temperature,mean,standard_deviation,min,max" << endl;
+	for (size_t i = 0; i < records_count; i++)
+	{
+		ofs << station_names[records.station[i]] << ',' << timestamp_year(records.timestamp[i]) << ',' << timestamp_month(records.timestamp[i]) << ',' << timestamp_day(records.timestamp[i]) << ','
+			<< setw(4) << setfill('0') << timestamp_time(records.timestamp[i]) << setfill(' ') << ',' << records.temperature[i] / 10.0f << ',' << rolling_result[i * 4] << ',' << rolling_result[i * 4 + 1] << ',' << rolling_result[i * 4 + 2] << ',' << rolling_result[i * 4 + 3] << '\n';
+	}
+	ofs.close();
+
+	cout << "ROLLING STATISTICS WRITTEN TO: " << output_file << endl;
+	cout << "***********************************************************************************************************************************************" << endl;
+}
+
+// ******************************************************************************INCREMENTAL*************************************************************************
+
+// Merge the moments of two sets of temperatures - pairwise update of the sum of squared differences (Chan et al.)
+void merge_moments(moments &total, const moments &partial)
+{
+	// Nothing to merge
+	if (!partial.count) return;
+	if (!total.count) { total = partial; return; }
+
+	// Difference of the means
+	double count = (double)total.count + partial.count;
+	double delta = partial.sum / partial.count - total.sum / total.count;
+
+	total.m2 += partial.m2 + delta * delta * total.count * partial.count / count;
+	total.sum += partial.sum;
+	total.count += partial.count;
+	total.min = min(total.min, partial.min);
+	total.max = max(total.max, partial.max);
+}
+
+// Merge two aggregate states - the partial state continues the total state
+void merge_aggregate_state(aggregate_state &total, const aggregate_state &partial)
+{
+	merge_moments(total.total, partial.total);
+
+	total.histogram.resize(histogram_bins);
+	for (size_t i = 0; i < partial.histogram.size(); i++)
+		total.histogram[i] += partial.histogram[i];
+
+	total.station_month.resize(max(total.station_month.size(), partial.station_month.size()));
+	for (size_t i = 0; i < partial.station_month.size(); i++)
+		merge_moments(total.station_month[i], partial.station_month[i]);
+
+	total.offset = partial.offset;
+}
+
+// Load the aggregate state - false if there is no saved state
+// The station names are restored so the appended records get the same station codes
+bool load_aggregate_state(const string &file, aggregate_state &state)
+{
+	// Input file stream
+	ifstream ifs(file, ios::binary);
+	if (!ifs.is_open()) return false;
+
+	// Offset in the data file and the signature of the file
+	ifs.read((char*)&state.offset, sizeof(state.offset));
+	ifs.read((char*)&state.source_size, sizeof(state.source_size));
+	ifs.read((char*)&state.source_modified, sizeof(state.source_modified));
+	ifs.read((char*)&state.source_fingerprint, sizeof(state.source_fingerprint));
+
+	// Station names
+	cl_uint stations = 0;
+	ifs.read((char*)&stations, sizeof(stations));
+	station_names.resize(stations);
+	for (string &name : station_names)
+	{
+		cl_uint length = 0;
+		ifs.read((char*)&length, sizeof(length));
+		name.resize(length);
+		ifs.read(&name[0], length);
+	}
+
+	// Total, histogram and station and month moments
+	state.histogram.resize(histogram_bins);
+	state.station_month.resize(stations * 12);
+	ifs.read((char*)&state.total, sizeof(moments));
+	ifs.read((char*)&state.histogram[0], histogram_bins * sizeof(cl_ulong));
+	if (stations) ifs.read((char*)&state.station_month[0], state.station_month.size() * sizeof(moments));
+
+	return ifs.good();
+}
+
+// Save the aggregate state
+void save_aggregate_state(const string &file, const aggregate_state &state)
+{
+	// Output file stream
+	ofstream ofs(file, ios::binary);
+
+	// Offset in the data file and the signature of the file
+	ofs.write((const char*)&state.offset, sizeof(state.offset));
+	ofs.write((const char*)&state.source_size, sizeof(state.source_size));
+	ofs.write((const char*)&state.source_modified, sizeof(state.source_modified));
+	ofs.write((const char*)&state.source_fingerprint, sizeof(state.source_fingerprint));
+
+	// Station names
+	cl_uint stations = (cl_uint)station_names.size();
+	ofs.write((const char*)&stations, sizeof(stations));
+	for (const string &name : station_names)
+	{
+		cl_uint length = (cl_uint)name.size();
+		ofs.write((const char*)&length, sizeof(length));
+		ofs.write(name.data(), length);
+	}
+
+	// Total, histogram and station and month moments - one cell per station and month
+	vector<moments> station_month(state.station_month);
+	station_month.resize(stations * 12);
+	ofs.write((const char*)&state.total, sizeof(moments));
+	ofs.write((const char*)&state.histogram[0], histogram_bins * sizeof(cl_ulong));
+	if (stations) ofs.write((const char*)&station_month[0], station_month.size() * sizeof(moments));
+}
+
+// Fingerprint of the bytes of the data file before an offset - FNV-1a of up to the last 4 KB
+cl_ulong source_fingerprint(const char* file, streamoff offset)
+{
+	// Bytes before the offset
+	ifstream ifs(file, ios::binary);
+	streamoff start = max(offset - (streamoff)4096, (streamoff)0);
+	vector<char> bytes((size_t)(offset - start));
+	ifs.seekg(start);
+	if (!bytes.empty()) ifs.read(&bytes[0], bytes.size());
+	if (ifs.gcount() != (streamsize)bytes.size()) return 0;
+
+	// FNV-1a
+	cl_ulong hash = 14695981039346656037ull;
+	for (char byte : bytes)
+		hash = (hash ^ (unsigned char)byte) * 1099511628211ull;
+	return hash;
+}
+
+// Check the saved state belongs to the data file - it was not truncated or rewritten since
+// An unchanged signature has nothing appended, otherwise the file must still reach the offset with the same bytes before it
+bool state_matches_source(const char* file, const aggregate_state &state)
+{
+	cl_long size = 0, modified = 0;
+	source_signature(file, size, modified);
+	if (size == state.source_size && modified == state.source_modified) return true;
+	return size >= state.offset && modified >= state.source_modified && source_fingerprint(file, state.offset) == state.source_fingerprint;
+}
+
+// Reduce the records into an aggregate state on device
+aggregate_state grouped_moments_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, record_columns &records, size_t local_size)
+{
+	// Number of records, cells and the padded number of work items
+	size_t records_count = records.temperature.size();
+	size_t cells = station_names.size() * 12;
+	size_t input_elements = round_up(records_count, local_size);
+
+	// Size in bytes
+	size_t station_size = records_count * sizeof(cl_uchar);
+	size_t timestamp_size = records_count * sizeof(cl_uint);
+	size_t input_size = records_count * sizeof(fixed_point);
+	size_t cell_size = cells * sizeof(cl_long);
+	size_t cell_size_int = cells * sizeof(integer);
+	size_t histogram_size = histogram_bins * sizeof(cl_long);
+
+	// Device - pooled input buffers
+	cl::Buffer buffer_station = acquire_buffer(context, station_size);
+	cl::Buffer buffer_timestamp = acquire_buffer(context, timestamp_size);
+	cl::Buffer buffer_input = acquire_buffer(context, input_size);
+
+	// Device - pooled output buffers
+	cl::Buffer buffer_count = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_sum = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_sum_squares = acquire_buffer(context, cell_size);
+	cl::Buffer buffer_min = acquire_buffer(context, cell_size_int);
+	cl::Buffer buffer_max = acquire_buffer(context, cell_size_int);
+	cl::Buffer buffer_histogram = acquire_buffer(context, histogram_size);
+
+	// Copy the columns to device memory and fill the outputs with the neutral elements
+	vector<cl::Event> events_upload(3);
+	queue.enqueueWriteBuffer(buffer_station, CL_TRUE, 0, station_size, &records.station[0], NULL, &events_upload[0]);
+	queue.enqueueWriteBuffer(buffer_timestamp, CL_TRUE, 0, timestamp_size, &records.timestamp[0], NULL, &events_upload[1]);
+	queue.enqueueWriteBuffer(buffer_input, CL_TRUE, 0, input_size, &records.temperature[0], NULL, &events_upload[2]);
+	queue.enqueueFillBuffer(buffer_count, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_sum, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_sum_squares, (cl_long)0, 0, cell_size);
+	queue.enqueueFillBuffer(buffer_min, INT_MAX, 0, cell_size_int);
+	queue.enqueueFillBuffer(buffer_max, INT_MIN, 0, cell_size_int);
+	queue.enqueueFillBuffer(buffer_histogram, (cl_long)0, 0, histogram_size);
+
+	// Kernel intialisation from the cache
+	cl::Kernel &kernel_moments = cached_kernel(program, "grouped_moments");
+	kernel_moments.setArg(0, buffer_station);
+	kernel_moments.setArg(1, buffer_timestamp);
+	kernel_moments.setArg(2, buffer_input);
+	kernel_moments.setArg(3, buffer_count);
+	kernel_moments.setArg(4, buffer_sum);
+	kernel_moments.setArg(5, buffer_sum_squares);
+	kernel_moments.setArg(6, buffer_min);
+	kernel_moments.setArg(7, buffer_max);
+	kernel_moments.setArg(8, buffer_histogram);
+	kernel_moments.setArg(9, cl::Local(cell_size_int));
+	kernel_moments.setArg(10, cl::Local(cell_size_int));
+	kernel_moments.setArg(11, cl::Local(cell_size_int));
+	kernel_moments.setArg(12, cl::Local(cell_size_int));
+	kernel_moments.setArg(13, cl::Local(cell_size_int));
+	kernel_moments.setArg(14, cl::Local(histogram_bins * sizeof(integer)));
+	kernel_moments.setArg(15, (integer)cells);
+	kernel_moments.setArg(16, histogram_min);
+	kernel_moments.setArg(17, histogram_bin_width);
+	kernel_moments.setArg(18, histogram_bins);
+	kernel_moments.setArg(19, (integer)records_count);
+
+	// Call the kernel - a single pass over the records
+	cl::Event event_moments_profiling;
+	queue.enqueueNDRangeKernel(kernel_moments, cl::NullRange, cl::NDRange(input_elements), cl::NDRange(local_size), NULL, &event_moments_profiling);
 
 	// Copy the result from device to host
-	queue.enqueueReadBuffer(buffer_output_redux_std_dev, CL_TRUE, 0, output_size, &temperature_redux_std_dev_result[0], NULL, &event_redux_std_dev_transfer);
+	vector<cl_long> cell_count(cells), cell_sum(cells), cell_sum_squares(cells), histogram(histogram_bins);
+	vector<integer> cell_min(cells), cell_max(cells);
+	vector<cl::Event> events_read(6);
+	queue.enqueueReadBuffer(buffer_count, CL_TRUE, 0, cell_size, &cell_count[0], NULL, &events_read[0]);
+	queue.enqueueReadBuffer(buffer_sum, CL_TRUE, 0, cell_size, &cell_sum[0], NULL, &events_read[1]);
+	queue.enqueueReadBuffer(buffer_sum_squares, CL_TRUE, 0, cell_size, &cell_sum_squares[0], NULL, &events_read[2]);
+	queue.enqueueReadBuffer(buffer_min, CL_TRUE, 0, cell_size_int, &cell_min[0], NULL, &events_read[3]);
+	queue.enqueueReadBuffer(buffer_max, CL_TRUE, 0, cell_size_int, &cell_max[0], NULL, &events_read[4]);
+	queue.enqueueReadBuffer(buffer_histogram, CL_TRUE, 0, histogram_size, &histogram[0], NULL, &events_read[5]);
+
+	// Return the buffers to the pool
+	for (cl::Buffer *buffer : { &buffer_station, &buffer_timestamp, &buffer_input, &buffer_count, &buffer_sum, &buffer_sum_squares, &buffer_min, &buffer_max, &buffer_histogram })
+		release_buffer(*buffer);
 
 	// Display the profiling event data for the kernel
-	execution_time = event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-	transfer_time = event_redux_std_dev_transfer.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_redux_std_dev_transfer.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-
-	// Calculate variance
-	variance_float = (temperature_redux_std_dev_result[0] / 10.0f) / number_of_data_entries;
-	cout << "Total reduction kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time << "\t|| memory transfer [nano - seconds]: " << transfer_time			<< endl;
-	cout << "VARIANCE: "																																			<< variance_float			<< endl;
-	cout << "STANDARD DEVIATION: "																																	<< sqrt(variance_float)		<< endl;
-	cout << "***********************************************************************************************************************************************"									<< endl;
-#pragma endregion
+	cl_ulong execution_time = event_moments_profiling.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event_moments_profiling.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+	cout << "Total aggregate kernel luanches: 1 \t|| Total time for all executions [nano-seconds]: " << execution_time << endl;
+
+	// The kernel reads every record, adds its 5 moments to its cell and counts its bin - every group merges at most a work group of cells and the histogram
+	size_t record_size = sizeof(cl_uchar) + sizeof(cl_uint) + sizeof(fixed_point);
+	size_t merged_cells = (input_elements / local_size) * min(cells, local_size);
+	roofline_report("grouped moments", execution_time, (double)records_count * record_size + (double)merged_cells * (3 * sizeof(cl_long) + 2 * sizeof(integer))
+		+ (double)(input_elements / local_size) * histogram_size, (double)records_count * 10);
+	transfer_report("records upload", profiled_time(events_upload), (double)records_count * record_size, true);
+	transfer_report("read back", profiled_time(events_read), (double)(3 * cell_size + 2 * cell_size_int + histogram_size), false);
+
+	// Convert the fixed point sums to moments - divide by 10 due to the multiplication of the ints
+	aggregate_state state;
+	state.histogram.assign(histogram.begin(), histogram.end());
+	state.station_month.resize(cells);
+	for (size_t i = 0; i < cells; i++)
+	{
+		if (!cell_count[i]) continue;
+		moments &cell = state.station_month[i];
+		cell.count = cell_count[i];
+		cell.sum = cell_sum[i] / 10.0;
+		cell.m2 = (cell_sum_squares[i] - (double)cell_sum[i] * cell_sum[i] / cell_count[i]) / 100.0;
+		cell.min = cell_min[i] / 10.0f;
+		cell.max = cell_max[i] / 10.0f;
+		merge_moments(state.total, cell);
+	}
+
+	return state;
+}
+
+// Reduce the records appended since the saved state and merge them into it
+void incremental_kernel_calls(cl::Context &context, cl::CommandQueue &queue, cl::Program &program, size_t local_size)
+{
+	// Saved state - the whole file is read if there is none
+	aggregate_state state;
+	bool state_loaded = load_aggregate_state(state_file, state);
+
+	// A state of another file, or of this file before it was truncated or rewritten, is not merged - the whole file is read again
+	bool state_stale = state_loaded && !state_matches_source(file, state);
+	if (state_stale)
+	{
+		state = aggregate_state();
+		station_names.clear();
+		state_loaded = false;
+	}
+	state.histogram.resize(histogram_bins);
+
+	// Read in the records after the saved offset
+	hi_res_time_point start_of_read = hi_res_clock::now();
+	streamoff end_offset = state.offset;
+	record_columns records = load_file_records(file, state.offset, &end_offset);
+	auto time_elapsed_read_and_parse = chrono::duration_cast<chrono::milliseconds>(hi_res_clock::now() - start_of_read).count() / milli_to_seconds;
+
+	// Dsiaply info
+	cout << "***********************************************************************************************************************************************" << endl;
+	cout << (state_loaded ? "SAVED STATE: " : state_stale ? "STALE SAVED STATE - REBUILT: " : "NO SAVED STATE: ") << state_file << "\t|| records: " << state.total.count << "\t|| offset [bytes]: " << state.offset << endl;
+	cout << "APPENDED RECORDS: " << records.temperature.size() << "\t|| bytes: " << end_offset - state.offset << "\t|| time to read and parse [seconds]: " << time_elapsed_read_and_parse << endl;
+
+	// Reduce the appended records and merge them into the saved state
+	if (!records.temperature.empty())
+	{
+		aggregate_state appended = grouped_moments_kernel_calls(context, queue, program, records, local_size);
+		appended.offset = end_offset;
+		merge_aggregate_state(state, appended);
+	}
+	state.offset = end_offset;
+	source_signature(file, state.source_size, state.source_modified);
+	state.source_fingerprint = source_fingerprint(file, state.offset);
+	save_aggregate_state(state_file, state);
+
+	// Display the merged statistics
+	cout << "TOTAL RECORDS: " << state.total.count << endl;
+	if (state.total.count)
+	{
+		cout << "MAX TEMPERATURE: " << state.total.max << endl;
+		cout << "MIN TEMPERATURE: " << state.total.min << endl;
+		cout << "MEAN TEMPERATURE: " << state.total.sum / state.total.count << endl;
+		cout << "VARIANCE: " << state.total.m2 / state.total.count << endl;
+		cout << "STANDARD DEVIATION: " << sqrt(state.total.m2 / state.total.count) << endl;
+	}
+
+	// Display the statistics of each station - merged over the months
+	for (size_t station = 0; station < station_names.size(); station++)
+	{
+		moments station_total;
+		for (size_t month = 0; month < 12 && station * 12 + month < state.station_month.size(); month++)
+			merge_moments(station_total, state.station_month[station * 12 + month]);
+		if (station_total.count)
+			cout << station_names[station] << "\t|| records: " << station_total.count << "\t|| mean: " << station_total.sum / station_total.count
+				<< "\t|| standard deviation: " << sqrt(station_total.m2 / station_total.count) << "\t|| min: " << station_total.min << "\t|| max: " << station_total.max << endl;
+	}
+	cout << "***********************************************************************************************************************************************" << endl;
 }
\ No newline at end of file